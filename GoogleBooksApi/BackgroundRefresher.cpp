@@ -0,0 +1,89 @@
+#include "pch.h"
+
+#include "BackgroundRefresher.h"
+
+using namespace std;
+
+BackgroundRefresher::BackgroundRefresher(Task task) : m_task{ move(task) }
+{
+}
+
+BackgroundRefresher::~BackgroundRefresher()
+{
+    stop();
+}
+
+bool BackgroundRefresher::schedule(const string& key)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        if (m_stopping || !m_pending.insert(key).second)
+            return false;
+
+        m_queue.push_back(key);
+
+        if (!m_worker.joinable())
+            m_worker = thread{ &BackgroundRefresher::run, this };
+    }
+
+    m_wakeUp.notify_one();
+
+    return true;
+}
+
+void BackgroundRefresher::stop()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+        m_queue.clear();
+    }
+
+    m_wakeUp.notify_one();
+
+    if (!m_worker.joinable())
+        return;
+
+    if (m_worker.get_id() == this_thread::get_id())
+        m_worker.detach();
+    else
+        m_worker.join();
+}
+
+size_t BackgroundRefresher::pending() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_pending.size();
+}
+
+void BackgroundRefresher::run()
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_wakeUp.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+
+        if (m_stopping)
+            break;
+
+        auto key = move(m_queue.front());
+        m_queue.pop_front();
+
+        lock.unlock();
+
+        try
+        {
+            m_task(key);
+        }
+        catch (...)
+        {
+        }
+
+        lock.lock();
+        m_pending.erase(key);
+    }
+
+    m_pending.clear();
+}
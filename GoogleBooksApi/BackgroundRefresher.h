@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+/**
+ * @class BackgroundRefresher
+ * @brief Runs refresh tasks for cache keys on a worker thread.
+ *
+ * A key is queued at most once: scheduling a key whose refresh is already pending or
+ * running is a no-op. The worker thread is started on the first schedule and joined
+ * on destruction. Exceptions thrown by the task are swallowed, leaving the stale entry
+ * in place until its grace period ends.
+ */
+class BackgroundRefresher
+{
+public:
+    using Task = std::function<void(const std::string&)>;
+
+    /**
+     * @brief Constructs a refresher running the given task for each scheduled key.
+     * @param task The refresh task.
+     */
+    explicit BackgroundRefresher(Task task);
+
+    /**
+     * @brief Stops the worker thread, dropping refreshes that have not started.
+     */
+    ~BackgroundRefresher();
+
+    BackgroundRefresher(const BackgroundRefresher&) = delete;
+    BackgroundRefresher& operator=(const BackgroundRefresher&) = delete;
+
+    /**
+     * @brief Queues a refresh for the key.
+     * @param key The cache key to refresh.
+     * @return True if the refresh was queued, false if one is already pending or the refresher is stopped.
+     */
+    bool schedule(const std::string& key);
+
+    /**
+     * @brief Stops the worker thread and waits for the running task to finish.
+     */
+    void stop();
+
+    /**
+     * @brief Retrieves the number of refreshes queued or running.
+     * @return The number of pending keys.
+     */
+    size_t pending() const;
+
+private:
+    Task m_task; ///< The refresh task.
+    mutable std::mutex m_mutex; ///< Guards the queue, the pending set and the stop flag.
+    std::condition_variable m_wakeUp; ///< Signals the worker that a key was queued or that it must stop.
+    std::deque<std::string> m_queue; ///< Keys waiting to be refreshed.
+    std::unordered_set<std::string> m_pending; ///< Keys queued or being refreshed.
+    bool m_stopping{ false }; ///< Set once the refresher is stopped.
+    std::thread m_worker; ///< The worker thread, started on the first schedule.
+
+    /**
+     * @brief Worker loop refreshing queued keys until stopped.
+     */
+    void run();
+};
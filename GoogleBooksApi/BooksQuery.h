@@ -0,0 +1,270 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SearchOptions.h"
+
+/**
+ * @class BooksQuery
+ * @brief Builder of a volumes search combining any set of qualifiers and parameters.
+ *
+ * Qualifiers are joined into a single q= expression in the order they are added,
+ * so searching by author AND subject AND language costs one request, e.g.
+ * BooksQuery{}.inAuthor("Ken Follett").subject("fiction").langRestrict("pt").
+ */
+class BooksQuery
+{
+public:
+    /**
+     * @enum Filter
+     * @brief Restriction on the availability of the returned volumes.
+     */
+    enum class Filter
+    {
+        None, ///< No restriction.
+        Partial, ///< Volumes with at least part of the text previewable.
+        Full, ///< Volumes with all of the text viewable.
+        FreeEbooks, ///< Free Google eBooks.
+        PaidEbooks, ///< Google eBooks with a price.
+        Ebooks ///< Google eBooks, paid or free.
+    };
+
+    /**
+     * @enum OrderBy
+     * @brief Ordering of the returned volumes.
+     */
+    enum class OrderBy
+    {
+        Relevance, ///< Most relevant first, the API default.
+        Newest ///< Most recently published first.
+    };
+
+    /**
+     * @enum PrintType
+     * @brief Kind of publication to return.
+     */
+    enum class PrintType
+    {
+        All, ///< Books and magazines, the API default.
+        Books, ///< Books only.
+        Magazines ///< Magazines only.
+    };
+
+    /**
+     * @struct Qualifier
+     * @brief A keyword-qualified part of the q= expression, such as inauthor:.
+     */
+    struct Qualifier
+    {
+        std::string keyword; ///< The qualifier keyword without its colon, e.g. "inauthor".
+        std::string value; ///< The unescaped text to match.
+    };
+
+    /**
+     * @class Qualifiers
+     * @brief View of the qualifiers of a query, in the order they were added.
+     */
+    class Qualifiers
+    {
+    public:
+        /**
+         * @brief Constructs a view of consecutive qualifiers.
+         * @param first The first qualifier.
+         * @param count The number of qualifiers.
+         */
+        Qualifiers(const Qualifier* first, std::size_t count) : m_first{ first }, m_count{ count } {}
+
+        const Qualifier* begin() const { return m_first; } ///< The first qualifier.
+        const Qualifier* end() const { return m_first + m_count; } ///< Past the last qualifier.
+        std::size_t size() const { return m_count; } ///< The number of qualifiers.
+        bool empty() const { return m_count == 0; } ///< Whether there is no qualifier.
+        const Qualifier& operator[](std::size_t index) const { return m_first[index]; } ///< The qualifier at an index.
+
+    private:
+        const Qualifier* m_first; ///< The first qualifier.
+        std::size_t m_count; ///< The number of qualifiers.
+    };
+
+    /**
+     * @brief Sets the free text searched in every field.
+     * @param text The search term.
+     * @return This query.
+     */
+    BooksQuery& term(const std::string& text) { m_term = text; return *this; }
+
+    /**
+     * @brief Restricts the results to titles containing the text.
+     * @param title The text to find in the title.
+     * @return This query.
+     */
+    BooksQuery& inTitle(const std::string& title) { return qualify("intitle", title); }
+
+    /**
+     * @brief Restricts the results to authors matching the text.
+     * @param author The text to find in the author.
+     * @return This query.
+     */
+    BooksQuery& inAuthor(const std::string& author) { return qualify("inauthor", author); }
+
+    /**
+     * @brief Restricts the results to publishers matching the text.
+     * @param publisher The text to find in the publisher.
+     * @return This query.
+     */
+    BooksQuery& inPublisher(const std::string& publisher) { return qualify("inpublisher", publisher); }
+
+    /**
+     * @brief Restricts the results to a category.
+     * @param subject The text to find in the category list.
+     * @return This query.
+     */
+    BooksQuery& subject(const std::string& subject) { return qualify("subject", subject); }
+
+    /**
+     * @brief Restricts the results to an ISBN.
+     * @param isbn The ISBN-10 or ISBN-13.
+     * @return This query.
+     */
+    BooksQuery& isbn(const std::string& isbn) { return qualify("isbn", isbn); }
+
+    /**
+     * @brief Restricts the results to a Library of Congress Control Number.
+     * @param lccn The control number.
+     * @return This query.
+     */
+    BooksQuery& lccn(const std::string& lccn) { return qualify("lccn", lccn); }
+
+    /**
+     * @brief Restricts the results to an Online Computer Library Center number.
+     * @param oclc The OCLC number.
+     * @return This query.
+     */
+    BooksQuery& oclc(const std::string& oclc) { return qualify("oclc", oclc); }
+
+    /**
+     * @brief Restricts the results by availability.
+     * @param filter The availability filter.
+     * @return This query.
+     */
+    BooksQuery& filter(Filter filter) { m_filter = filter; return *this; }
+
+    /**
+     * @brief Sets the ordering of the results.
+     * @param orderBy The ordering.
+     * @return This query.
+     */
+    BooksQuery& orderBy(OrderBy orderBy) { m_orderBy = orderBy; return *this; }
+
+    /**
+     * @brief Restricts the results to a language.
+     * @param language A two-letter ISO-639-1 code, such as "en" or "pt".
+     * @return This query.
+     */
+    BooksQuery& langRestrict(const std::string& language) { m_language = language; return *this; }
+
+    /**
+     * @brief Restricts the results to a kind of publication.
+     * @param printType The kind of publication.
+     * @return This query.
+     */
+    BooksQuery& printType(PrintType printType) { m_printType = printType; return *this; }
+
+    /**
+     * @brief Sets the index of the first result to return.
+     * @param startIndex The zero-based index.
+     * @return This query.
+     */
+    BooksQuery& startIndex(int startIndex) { m_startIndex = startIndex; return *this; }
+
+    /**
+     * @brief Sets the maximum number of results to return.
+     * @param maxResults The page size, at most 40.
+     * @return This query.
+     */
+    BooksQuery& maxResults(int maxResults) { m_maxResults = maxResults; return *this; }
+
+    /**
+     * @brief Sets the fields selector and projection of the response.
+     * @param options The partial response options.
+     * @return This query.
+     */
+    BooksQuery& options(const SearchOptions& options) { m_options = options; return *this; }
+
+    const std::string& term() const { return m_term; } ///< The free text, possibly empty.
+    Qualifiers qualifiers() const { return { m_qualifiers.data(), m_qualifierCount }; } ///< The qualifiers in the order they were added.
+    Filter filter() const { return m_filter; } ///< The availability filter.
+    std::optional<OrderBy> orderBy() const { return m_orderBy; } ///< The ordering, when set.
+    const std::string& langRestrict() const { return m_language; } ///< The language code, possibly empty.
+    std::optional<PrintType> printType() const { return m_printType; } ///< The kind of publication, when set.
+    std::optional<int> startIndex() const { return m_startIndex; } ///< The index of the first result, when set.
+    std::optional<int> maxResults() const { return m_maxResults; } ///< The page size, when set.
+    const SearchOptions& options() const { return m_options; } ///< The partial response options.
+
+    /**
+     * @brief Resets every qualifier and parameter while keeping the storage for reuse.
+     *
+     * The qualifiers are kept and overwritten by the next ones, so that refilling the
+     * query with values no longer than before allocates nothing.
+     * @return This query, now empty.
+     */
+    BooksQuery& clear()
+    {
+        m_term.clear();
+        m_qualifierCount = 0;
+        m_filter = Filter::None;
+        m_orderBy.reset();
+        m_language.clear();
+        m_printType.reset();
+        m_startIndex.reset();
+        m_maxResults.reset();
+
+        // Every option is reset at once, only the buffer of the fields selector is kept.
+        auto fields = std::move(m_options.fields);
+        fields.clear();
+        m_options = SearchOptions{};
+        m_options.fields = std::move(fields);
+        return *this;
+    }
+
+    /**
+     * @brief Tells whether the query has neither a term nor a qualifier.
+     * @return True when there is nothing to search for.
+     */
+    bool empty() const { return m_term.empty() && m_qualifierCount == 0; }
+
+private:
+    std::string m_term; ///< The free text.
+    std::vector<Qualifier> m_qualifiers; ///< The qualifiers in the order they were added, then those of earlier queries kept for their storage.
+    std::size_t m_qualifierCount{ 0 }; ///< The number of qualifiers of this query.
+    Filter m_filter{ Filter::None }; ///< The availability filter.
+    std::optional<OrderBy> m_orderBy; ///< The ordering.
+    std::string m_language; ///< The language code.
+    std::optional<PrintType> m_printType; ///< The kind of publication.
+    std::optional<int> m_startIndex; ///< The index of the first result.
+    std::optional<int> m_maxResults; ///< The page size.
+    SearchOptions m_options; ///< The partial response options.
+
+    /**
+     * @brief Appends a qualifier to the q= expression.
+     * @param keyword The qualifier keyword.
+     * @param value The text to match.
+     * @return This query.
+     */
+    BooksQuery& qualify(const char* keyword, const std::string& value)
+    {
+        if (m_qualifierCount == m_qualifiers.size())
+            m_qualifiers.push_back({ keyword, value });
+        else
+        {
+            m_qualifiers[m_qualifierCount].keyword.assign(keyword);
+            m_qualifiers[m_qualifierCount].value.assign(value);
+        }
+
+        ++m_qualifierCount;
+        return *this;
+    }
+};
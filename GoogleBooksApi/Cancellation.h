@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+/**
+ * @class CancellationToken
+ * @brief Lets a call observe whether its caller gave up on it.
+ *
+ * Tokens are handed out by a CancellationSource and share its state, so copying one is
+ * cheap and never allocates. A default-constructed token is never cancelled.
+ */
+class CancellationToken
+{
+public:
+    /**
+     * @brief Tells whether the source of this token was cancelled.
+     * @return True once CancellationSource::cancel() was called.
+     */
+    bool cancelled() const noexcept { return m_cancelled && m_cancelled->load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Tells whether this token can ever be cancelled.
+     * @return False for a default-constructed token.
+     */
+    bool cancellable() const noexcept { return m_cancelled != nullptr; }
+
+private:
+    friend class CancellationSource;
+
+    std::shared_ptr<const std::atomic<bool>> m_cancelled; ///< State shared with the source, null when the token cannot be cancelled.
+};
+
+/**
+ * @class CancellationSource
+ * @brief Cancels every call holding one of its tokens, e.g. when the client they serve disconnects.
+ */
+class CancellationSource
+{
+public:
+    /**
+     * @brief Constructs a source that is not cancelled.
+     */
+    CancellationSource() : m_cancelled{ std::make_shared<std::atomic<bool>>(false) } {}
+
+    /**
+     * @brief Retrieves a token observing this source.
+     * @return The token, to be passed with the calls to cancel.
+     */
+    CancellationToken token() const
+    {
+        CancellationToken token;
+        token.m_cancelled = m_cancelled;
+        return token;
+    }
+
+    /**
+     * @brief Cancels the calls holding a token of this source; transfers in progress are aborted.
+     */
+    void cancel() noexcept { m_cancelled->store(true, std::memory_order_relaxed); }
+
+    /**
+     * @brief Tells whether cancel() was called.
+     * @return True once cancelled.
+     */
+    bool cancelled() const noexcept { return m_cancelled->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled; ///< State shared with the tokens.
+};
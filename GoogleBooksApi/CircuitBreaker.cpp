@@ -0,0 +1,123 @@
+#include "pch.h"
+
+#include <algorithm>
+
+#include "CircuitBreaker.h"
+
+using namespace std;
+
+CircuitBreaker::CircuitBreaker(const CircuitPolicy& policy)
+{
+    setPolicy(policy);
+}
+
+void CircuitBreaker::setPolicy(const CircuitPolicy& policy)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_policy = policy;
+    reset();
+}
+
+CircuitPolicy CircuitBreaker::policy() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_policy;
+}
+
+CircuitBreaker::State CircuitBreaker::state()
+{
+    lock_guard<mutex> lock(m_mutex);
+    updateState();
+    return m_state;
+}
+
+bool CircuitBreaker::allow()
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (!m_policy.enabled)
+        return true;
+
+    updateState();
+
+    switch (m_state)
+    {
+    case State::Closed:
+        return true;
+    case State::HalfOpen:
+        if (m_probesSent >= m_policy.halfOpenProbes)
+            return false;
+
+        ++m_probesSent;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void CircuitBreaker::record(bool success)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (!m_policy.enabled)
+        return;
+
+    if (m_state == State::HalfOpen)
+    {
+        if (!success)
+            trip();
+        else if (++m_probesSucceeded >= m_policy.halfOpenProbes)
+            reset();
+
+        return;
+    }
+
+    if (m_state != State::Closed)
+        return;
+
+    if (m_recorded == m_window.size())
+        m_failures -= m_window[m_next];
+    else
+        ++m_recorded;
+
+    m_window[m_next] = !success;
+    m_failures += !success;
+    m_next = (m_next + 1) % m_window.size();
+
+    if (m_recorded >= max<size_t>(m_policy.minimumRequests, 1) &&
+        static_cast<double>(m_failures) >= m_policy.failureRateThreshold * m_recorded)
+        trip();
+}
+
+void CircuitBreaker::abandon()
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (m_state == State::HalfOpen && m_probesSent > m_probesSucceeded)
+        --m_probesSent;
+}
+
+void CircuitBreaker::updateState()
+{
+    if (m_state == State::Open && Clock::now() >= m_openUntil)
+    {
+        m_state = State::HalfOpen;
+        m_probesSent = 0;
+        m_probesSucceeded = 0;
+    }
+}
+
+void CircuitBreaker::trip()
+{
+    m_state = State::Open;
+    m_openUntil = Clock::now() + m_policy.openDuration;
+}
+
+void CircuitBreaker::reset()
+{
+    m_state = State::Closed;
+    m_window.assign(max<size_t>(m_policy.windowSize, 1), false);
+    m_next = 0;
+    m_recorded = 0;
+    m_failures = 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "DllApi.h"
+
+/**
+ * @enum CircuitFallback
+ * @brief What a request gets while the circuit is open.
+ */
+enum class CircuitFallback
+{
+    FailFast, ///< An exception, without waiting for the transport.
+    ServeCached ///< The cached response however old, or an exception when there is none.
+};
+
+/**
+ * @struct CircuitPolicy
+ * @brief When the circuit opens and how it recovers.
+ */
+struct CircuitPolicy
+{
+    bool enabled{ true }; ///< Whether the breaker guards the transport at all.
+    double failureRateThreshold{ 0.5 }; ///< Fraction of failed transfers in the window that opens the circuit.
+    size_t minimumRequests{ 20 }; ///< Transfers the window must hold before the rate is trusted.
+    size_t windowSize{ 50 }; ///< Number of most recent transfers the rate is computed over.
+    std::chrono::milliseconds openDuration{ 30000 }; ///< Time the circuit stays open before probing.
+    size_t halfOpenProbes{ 3 }; ///< Trial transfers let through when probing; all must succeed to close the circuit.
+    CircuitFallback fallback{ CircuitFallback::ServeCached }; ///< What requests get while the circuit is open.
+};
+
+/**
+ * @class CircuitBreaker
+ * @brief Stops sending transfers to an upstream that keeps failing.
+ *
+ * While closed, the outcomes of the last transfers are kept in a window, and the circuit
+ * opens when their failure rate reaches the threshold. While open, transfers are refused
+ * at once. After openDuration the circuit is half-open: a few probes are let through,
+ * closing the circuit if they all succeed and opening it again on the first failure.
+ */
+class DLL_API CircuitBreaker
+{
+public:
+    /**
+     * @enum State
+     * @brief Position of the circuit.
+     */
+    enum class State
+    {
+        Closed, ///< Transfers flow and their outcomes are recorded.
+        Open, ///< Transfers are refused.
+        HalfOpen ///< A limited number of probes are let through.
+    };
+
+    /**
+     * @brief Constructs a closed breaker.
+     * @param policy The thresholds and recovery.
+     */
+    explicit CircuitBreaker(const CircuitPolicy& policy = {});
+
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    /**
+     * @brief Replaces the policy and closes the circuit.
+     * @param policy The new thresholds and recovery.
+     */
+    void setPolicy(const CircuitPolicy& policy);
+
+    /**
+     * @brief Retrieves the current policy.
+     * @return A copy of the policy.
+     */
+    CircuitPolicy policy() const;
+
+    /**
+     * @brief Retrieves the position of the circuit.
+     * @return The state, moving from open to half-open once openDuration has elapsed.
+     */
+    State state();
+
+    /**
+     * @brief Asks to send a transfer.
+     *
+     * Every allowed transfer must be followed by record() or abandon().
+     * @return True if the transfer may be sent.
+     */
+    bool allow();
+
+    /**
+     * @brief Records the outcome of an allowed transfer.
+     * @param success False for transport failures, 429 and 5xx responses.
+     */
+    void record(bool success);
+
+    /**
+     * @brief Gives back an allowed transfer that was not sent.
+     */
+    void abandon();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    mutable std::mutex m_mutex; ///< Guards the state and the window.
+    CircuitPolicy m_policy; ///< The thresholds and recovery.
+    State m_state{ State::Closed }; ///< Position of the circuit.
+    std::vector<bool> m_window; ///< Outcomes of the last transfers, true for failures.
+    size_t m_next{ 0 }; ///< Slot of the window the next outcome goes to.
+    size_t m_recorded{ 0 }; ///< Outcomes in the window.
+    size_t m_failures{ 0 }; ///< Failures in the window.
+    Clock::time_point m_openUntil{}; ///< End of the open period.
+    size_t m_probesSent{ 0 }; ///< Probes let through while half-open.
+    size_t m_probesSucceeded{ 0 }; ///< Probes that succeeded while half-open.
+
+    /**
+     * @brief Moves an open circuit to half-open once its open period has elapsed.
+     */
+    void updateState();
+
+    /**
+     * @brief Opens the circuit for openDuration.
+     */
+    void trip();
+
+    /**
+     * @brief Closes the circuit with an empty window.
+     */
+    void reset();
+};
@@ -0,0 +1,215 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+#include "ClientMetrics.h"
+#include "ConcurrencyLimiter.h"
+#include "RateLimiter.h"
+
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Retrieves the label value of an outcome.
+     * @param outcome The outcome.
+     * @return The label value.
+     */
+    const char* outcomeName(RequestOutcome outcome)
+    {
+        switch (outcome)
+        {
+        case RequestOutcome::Success:
+            return "success";
+        case RequestOutcome::ApiError:
+            return "api_error";
+        default:
+            return "failure";
+        }
+    }
+
+    /**
+     * @brief Retrieves the label value of a cache.
+     * @param cache The cache.
+     * @return The label value.
+     */
+    const char* cacheName(CacheKind cache)
+    {
+        return cache == CacheKind::Query ? "query" : "volume";
+    }
+
+    /**
+     * @brief Converts a duration to seconds, the unit of Prometheus.
+     * @param duration The duration.
+     * @return The duration in seconds.
+     */
+    double seconds(chrono::nanoseconds duration)
+    {
+        return chrono::duration<double>(duration).count();
+    }
+
+    /**
+     * @brief Writes the HELP and TYPE lines of a metric.
+     * @param out The stream to write to.
+     * @param name The metric name.
+     * @param type The metric type, e.g. "counter".
+     * @param help The description of the metric.
+     */
+    void describe(ostream& out, const char* name, const char* type, const char* help)
+    {
+        out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+    }
+}
+
+ClientMetrics::ClientMetrics() : m_inFlight{ 0 }, m_transfers{ 0 }, m_bytesReceived{ 0 }, m_connectionsReused{ 0 }, m_tlsHandshakes{ 0 },
+    m_connectionsOpen{ 0 }, m_retries{ 0 }
+{
+    for (auto& count : m_nameLookups)
+        count.store(0, memory_order_relaxed);
+
+    for (auto& outcomes : m_requests)
+    {
+        for (auto& count : outcomes)
+            count.store(0, memory_order_relaxed);
+    }
+
+    for (auto& lookups : m_cacheLookups)
+    {
+        for (auto& count : lookups)
+            count.store(0, memory_order_relaxed);
+    }
+}
+
+void ClientMetrics::recordRequest(LatencyOperation operation, RequestOutcome outcome)
+{
+    m_requests[static_cast<size_t>(operation)][static_cast<size_t>(outcome)].fetch_add(1, memory_order_relaxed);
+}
+
+void ClientMetrics::recordCacheLookup(CacheKind cache, bool hit)
+{
+    m_cacheLookups[static_cast<size_t>(cache)][hit].fetch_add(1, memory_order_relaxed);
+}
+
+void ClientMetrics::transferFinished(const TransferTiming& timing)
+{
+    m_inFlight.fetch_sub(1, memory_order_relaxed);
+
+    if (!timing.transferred)
+        return;
+
+    m_transfers.fetch_add(1, memory_order_relaxed);
+    m_bytesReceived.fetch_add(timing.bytesDownloaded, memory_order_relaxed);
+    if (timing.connectionReused)
+        m_connectionsReused.fetch_add(1, memory_order_relaxed);
+    else if (timing.appConnect.count() > 0)
+        m_tlsHandshakes.fetch_add(1, memory_order_relaxed);
+}
+
+void ClientMetrics::recordNameLookup(bool cached)
+{
+    m_nameLookups[cached].fetch_add(1, memory_order_relaxed);
+}
+
+ConnectionStats ClientMetrics::connectionStats() const
+{
+    ConnectionStats stats;
+    stats.reused = m_connectionsReused.load(memory_order_relaxed);
+    stats.opened = m_transfers.load(memory_order_relaxed) - stats.reused;
+    stats.tlsHandshakes = m_tlsHandshakes.load(memory_order_relaxed);
+    stats.dnsLookups = m_nameLookups[0].load(memory_order_relaxed);
+    stats.dnsCacheHits = m_nameLookups[1].load(memory_order_relaxed);
+
+    // A transfer holds at most one connection, and may not have connected yet.
+    const auto open = max<int64_t>(m_connectionsOpen.load(memory_order_relaxed), 0);
+    stats.active = min(max<int64_t>(m_inFlight.load(memory_order_relaxed), 0), open);
+    stats.idle = open - stats.active;
+
+    return stats;
+}
+
+string ClientMetrics::render() const
+{
+    ostringstream out;
+    out.imbue(locale::classic());
+    out.precision(numeric_limits<double>::max_digits10);
+
+    describe(out, "googlebooks_requests_total", "counter", "Calls of the search methods by method and outcome.");
+    // The search methods come first among the operations, up to Volume.
+    for (size_t operation = 0; operation <= static_cast<size_t>(LatencyOperation::Volume); ++operation)
+    {
+        for (size_t outcome = 0; outcome < outcomeCount; ++outcome)
+        {
+            out << "googlebooks_requests_total{method=\"" << latencyOperationName(static_cast<LatencyOperation>(operation))
+                << "\",outcome=\"" << outcomeName(static_cast<RequestOutcome>(outcome)) << "\"} "
+                << m_requests[operation][outcome].load(memory_order_relaxed) << '\n';
+        }
+    }
+
+    describe(out, "googlebooks_duration_seconds", "summary", "Latency of the search methods, transfers and parsing.");
+    for (size_t operation = 0; operation < operationCount; ++operation)
+    {
+        const auto name = latencyOperationName(static_cast<LatencyOperation>(operation));
+        const auto summary = m_latencies[operation].summary();
+        const auto totals = m_latencies[operation].totals();
+        const pair<const char*, chrono::nanoseconds> quantiles[]{
+            { "0.5", summary.p50 }, { "0.9", summary.p90 }, { "0.99", summary.p99 }, { "0.999", summary.p999 } };
+
+        for (const auto& [quantile, value] : quantiles)
+            out << "googlebooks_duration_seconds{operation=\"" << name << "\",quantile=\"" << quantile << "\"} " << seconds(value) << '\n';
+
+        out << "googlebooks_duration_seconds_sum{operation=\"" << name << "\"} " << seconds(totals.sum) << '\n';
+        out << "googlebooks_duration_seconds_count{operation=\"" << name << "\"} " << totals.count << '\n';
+    }
+
+    describe(out, "googlebooks_cache_lookups_total", "counter", "Cache lookups by cache and result.");
+    for (size_t cache = 0; cache < cacheCount; ++cache)
+    {
+        const auto name = cacheName(static_cast<CacheKind>(cache));
+        out << "googlebooks_cache_lookups_total{cache=\"" << name << "\",result=\"miss\"} " << m_cacheLookups[cache][0].load(memory_order_relaxed) << '\n';
+        out << "googlebooks_cache_lookups_total{cache=\"" << name << "\",result=\"hit\"} " << m_cacheLookups[cache][1].load(memory_order_relaxed) << '\n';
+    }
+
+    const auto transfers = m_transfers.load(memory_order_relaxed);
+    const auto reused = m_connectionsReused.load(memory_order_relaxed);
+
+    describe(out, "googlebooks_transfers_in_flight", "gauge", "Transfers in progress.");
+    out << "googlebooks_transfers_in_flight " << m_inFlight.load(memory_order_relaxed) << '\n';
+    describe(out, "googlebooks_transfers_total", "counter", "Transfers that received a response.");
+    out << "googlebooks_transfers_total " << transfers << '\n';
+    describe(out, "googlebooks_received_bytes_total", "counter", "Bytes of response bodies received.");
+    out << "googlebooks_received_bytes_total " << m_bytesReceived.load(memory_order_relaxed) << '\n';
+    describe(out, "googlebooks_connections_reused_total", "counter", "Transfers sent on an idle connection instead of a new one.");
+    out << "googlebooks_connections_reused_total " << reused << '\n';
+    describe(out, "googlebooks_connection_reuse_ratio", "gauge", "Fraction of the transfers that reused a connection.");
+    out << "googlebooks_connection_reuse_ratio " << (transfers ? static_cast<double>(reused) / transfers : 0.0) << '\n';
+    const auto connections = connectionStats();
+    describe(out, "googlebooks_connections_opened_total", "counter", "Transfers that opened a new connection.");
+    out << "googlebooks_connections_opened_total " << connections.opened << '\n';
+    describe(out, "googlebooks_tls_handshakes_total", "counter", "TLS handshakes performed by new connections.");
+    out << "googlebooks_tls_handshakes_total " << connections.tlsHandshakes << '\n';
+    describe(out, "googlebooks_dns_lookups_total", "counter", "Host name lookups of new connections by result.");
+    out << "googlebooks_dns_lookups_total{result=\"resolved\"} " << connections.dnsLookups << '\n';
+    out << "googlebooks_dns_lookups_total{result=\"cached\"} " << connections.dnsCacheHits << '\n';
+    describe(out, "googlebooks_connections", "gauge", "Open connections of the pool by state.");
+    out << "googlebooks_connections{state=\"active\"} " << connections.active << '\n';
+    out << "googlebooks_connections{state=\"idle\"} " << connections.idle << '\n';
+    describe(out, "googlebooks_retries_total", "counter", "Retries of transient failures.");
+    out << "googlebooks_retries_total " << m_retries.load(memory_order_relaxed) << '\n';
+
+    const auto rateLimit = RateLimiter::shared().stats();
+    describe(out, "googlebooks_rate_limiter_waits_total", "counter", "Requests of the process that waited for a rate limiter token.");
+    out << "googlebooks_rate_limiter_waits_total " << rateLimit.waits << '\n';
+    describe(out, "googlebooks_rate_limiter_wait_seconds_total", "counter", "Time requests of the process spent waiting for a rate limiter token.");
+    out << "googlebooks_rate_limiter_wait_seconds_total " << seconds(rateLimit.waited) << '\n';
+    describe(out, "googlebooks_rate_limiter_rejections_total", "counter", "Requests of the process refused by the rate limiter.");
+    out << "googlebooks_rate_limiter_rejections_total " << rateLimit.rejections << '\n';
+
+    describe(out, "googlebooks_concurrency_limit", "gauge", "Adaptive window of concurrent transfers of the process.");
+    out << "googlebooks_concurrency_limit " << ConcurrencyLimiter::shared().limit() << '\n';
+
+    return out.str();
+}
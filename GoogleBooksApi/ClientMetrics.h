@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "DllApi.h"
+#include "HttpTypes.h"
+#include "LatencyHistogram.h"
+
+/**
+ * @enum RequestOutcome
+ * @brief How a call of a search method ended.
+ */
+enum class RequestOutcome
+{
+    Success, ///< Results, possibly none.
+    ApiError, ///< An error object or an empty body returned by the API, such as for an invalid key or an exhausted 503.
+    Failure, ///< An exception: transport failure, open circuit, deadline, cancellation...
+    Count ///< Number of outcomes, not an outcome.
+};
+
+/**
+ * @enum CacheKind
+ * @brief Caches whose lookups are counted.
+ */
+enum class CacheKind
+{
+    Query, ///< Parsed responses keyed by resource.
+    Volume, ///< Volumes keyed by id or ISBN.
+    Count ///< Number of caches, not a cache.
+};
+
+/**
+ * @struct ConnectionStats
+ * @brief Health of the connection pool of a GoogleBooksInterface.
+ */
+struct ConnectionStats
+{
+    std::uint64_t opened{ 0 }; ///< Transfers that opened a new connection.
+    std::uint64_t reused{ 0 }; ///< Transfers sent on an idle connection of the pool.
+    std::uint64_t tlsHandshakes{ 0 }; ///< TLS handshakes performed by new connections.
+    std::uint64_t dnsLookups{ 0 }; ///< Host names resolved for new connections.
+    std::uint64_t dnsCacheHits{ 0 }; ///< New connections whose host name was found in the DNS cache.
+    std::int64_t active{ 0 }; ///< Open connections carrying a transfer.
+    std::int64_t idle{ 0 }; ///< Open connections waiting in the pool.
+};
+
+/**
+ * @class ClientMetrics
+ * @brief Counters and latency histograms of one GoogleBooksInterface.
+ *
+ * Every counter is a relaxed atomic, so recording never blocks a request. render()
+ * writes them, together with the process-wide rate limiter and concurrency window,
+ * in the Prometheus text exposition format.
+ *
+ * Connections are counted by the transport: each transfer tells whether it opened a
+ * connection, and sockets are counted as the transport opens and closes them, so that
+ * open connections can be split into active and idle ones.
+ */
+class DLL_API ClientMetrics
+{
+public:
+    /**
+     * @brief Constructs zeroed metrics.
+     */
+    ClientMetrics();
+
+    ClientMetrics(const ClientMetrics&) = delete;
+    ClientMetrics& operator=(const ClientMetrics&) = delete;
+
+    /**
+     * @brief Retrieves the latency histogram of an operation.
+     * @param operation The operation.
+     * @return The histogram.
+     */
+    LatencyHistogram& latency(LatencyOperation operation) { return m_latencies[static_cast<size_t>(operation)]; }
+
+    /**
+     * @brief Retrieves the latency histogram of an operation.
+     * @param operation The operation.
+     * @return The histogram.
+     */
+    const LatencyHistogram& latency(LatencyOperation operation) const { return m_latencies[static_cast<size_t>(operation)]; }
+
+    /**
+     * @brief Counts a completed call of a search method.
+     * @param operation The method.
+     * @param outcome How the call ended.
+     */
+    void recordRequest(LatencyOperation operation, RequestOutcome outcome);
+
+    /**
+     * @brief Counts a cache lookup.
+     * @param cache The cache looked up.
+     * @param hit True when an entry was found, stale or not.
+     */
+    void recordCacheLookup(CacheKind cache, bool hit);
+
+    /**
+     * @brief Counts a transfer starting.
+     */
+    void transferStarted() { m_inFlight.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Counts a transfer ending, successfully or not.
+     * @param timing The timing of the transfer, empty when it failed.
+     */
+    void transferFinished(const TransferTiming& timing);
+
+    /**
+     * @brief Counts a socket opened by the transport.
+     */
+    void connectionOpened() { m_connectionsOpen.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Counts a socket closed by the transport.
+     */
+    void connectionClosed() { m_connectionsOpen.fetch_sub(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Counts the host name lookup of a new connection.
+     * @param cached True when the address was found in the DNS cache.
+     */
+    void recordNameLookup(bool cached);
+
+    /**
+     * @brief Retrieves the health of the connection pool.
+     * @return The connection counters and the open connections by state.
+     */
+    ConnectionStats connectionStats() const;
+
+    /**
+     * @brief Counts a retry of a failed transfer.
+     */
+    void recordRetry() { m_retries.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Renders every metric in the Prometheus text exposition format.
+     * @return The metrics, one sample per line.
+     */
+    std::string render() const;
+
+private:
+    static constexpr size_t operationCount{ static_cast<size_t>(LatencyOperation::Count) }; ///< Number of operations.
+    static constexpr size_t outcomeCount{ static_cast<size_t>(RequestOutcome::Count) }; ///< Number of outcomes.
+    static constexpr size_t cacheCount{ static_cast<size_t>(CacheKind::Count) }; ///< Number of caches.
+
+    std::array<LatencyHistogram, operationCount> m_latencies; ///< Latency of each operation.
+    std::array<std::array<std::atomic<uint64_t>, outcomeCount>, operationCount> m_requests; ///< Calls by method and outcome.
+    std::array<std::array<std::atomic<uint64_t>, 2>, cacheCount> m_cacheLookups; ///< Lookups by cache, misses then hits.
+    std::atomic<int64_t> m_inFlight; ///< Transfers in progress.
+    std::atomic<uint64_t> m_transfers; ///< Transfers completed with a response.
+    std::atomic<uint64_t> m_bytesReceived; ///< Bytes received by those transfers.
+    std::atomic<uint64_t> m_connectionsReused; ///< Transfers that reused an idle connection.
+    std::atomic<uint64_t> m_tlsHandshakes; ///< TLS handshakes of new connections.
+    std::array<std::atomic<uint64_t>, 2> m_nameLookups; ///< Lookups of new connections, resolved then cached.
+    std::atomic<int64_t> m_connectionsOpen; ///< Sockets opened and not closed yet.
+    std::atomic<uint64_t> m_retries; ///< Retries of failed transfers.
+};
@@ -0,0 +1,126 @@
+#include "pch.h"
+
+#include <algorithm>
+
+#include "ConcurrencyLimiter.h"
+
+using namespace std;
+
+namespace
+{
+    constexpr double latencySmoothing{ 0.1 }; ///< Weight of a new sample in the smoothed latency.
+    constexpr chrono::milliseconds cancellationPoll{ 10 }; ///< Longest wait before a cancellable caller checks its token again.
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(const ConcurrencyPolicy& policy) : m_policy{ policy }, m_limit{ 0.0 }
+{
+    setPolicy(policy);
+}
+
+ConcurrencyLimiter& ConcurrencyLimiter::shared()
+{
+    static ConcurrencyLimiter limiter;
+    return limiter;
+}
+
+void ConcurrencyLimiter::setPolicy(const ConcurrencyPolicy& policy)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_policy = policy;
+        m_limit = clamp(policy.initialLimit, policy.minLimit, max(policy.minLimit, policy.maxLimit));
+        m_smoothedLatency = 0.0;
+        m_nextCut = {};
+    }
+
+    m_slotFreed.notify_all();
+}
+
+ConcurrencyPolicy ConcurrencyLimiter::policy() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_policy;
+}
+
+double ConcurrencyLimiter::limit() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_limit;
+}
+
+size_t ConcurrencyLimiter::inFlight() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_inFlight;
+}
+
+bool ConcurrencyLimiter::acquire(Clock::time_point deadline, const CancellationToken& cancellation)
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    // A fractional window admits its integer part, and always at least one transfer.
+    const auto free = [this] { return m_inFlight < max<size_t>(1, static_cast<size_t>(m_limit)); };
+
+    if (deadline == Clock::time_point::max() && !cancellation.cancellable())
+        m_slotFreed.wait(lock, free);
+    else
+    {
+        // Nothing signals a cancellation, so a cancellable caller wakes up periodically to check it.
+        while (!free())
+        {
+            if (cancellation.cancelled() || Clock::now() >= deadline)
+                return false;
+
+            const auto wake = cancellation.cancellable() ? min(deadline, Clock::now() + cancellationPoll) : deadline;
+            m_slotFreed.wait_until(lock, wake);
+        }
+
+        if (cancellation.cancelled())
+            return false;
+    }
+
+    ++m_inFlight;
+    return true;
+}
+
+void ConcurrencyLimiter::release()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        --m_inFlight;
+    }
+
+    m_slotFreed.notify_one();
+}
+
+void ConcurrencyLimiter::release(long status, chrono::nanoseconds latency)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        --m_inFlight;
+
+        const auto sample = static_cast<double>(latency.count());
+        const auto spike = m_smoothedLatency > 0.0 && sample > m_policy.latencySpikeFactor * m_smoothedLatency;
+        const auto throttled = status == 429 || status == 503;
+
+        if (throttled || spike)
+        {
+            const auto now = Clock::now();
+            if (now >= m_nextCut)
+            {
+                m_limit = max(m_policy.minLimit, m_limit * m_policy.backoffRatio);
+                m_nextCut = now + chrono::nanoseconds{ static_cast<int64_t>(max(m_smoothedLatency, sample)) };
+            }
+        }
+        else
+        {
+            m_limit = min(m_policy.maxLimit, m_limit + 1.0 / m_limit);
+        }
+
+        // Throttled responses are fast and say nothing about the latency of served ones.
+        if (!throttled)
+            m_smoothedLatency = m_smoothedLatency > 0.0 ? m_smoothedLatency + latencySmoothing * (sample - m_smoothedLatency) : sample;
+    }
+
+    m_slotFreed.notify_all();
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "Cancellation.h"
+#include "DllApi.h"
+
+/**
+ * @struct ConcurrencyPolicy
+ * @brief Bounds and reactivity of the adaptive window of concurrent transfers.
+ */
+struct ConcurrencyPolicy
+{
+    double initialLimit{ 8.0 }; ///< Window before any response was observed.
+    double minLimit{ 1.0 }; ///< Smallest window, reached after repeated overload.
+    double maxLimit{ 64.0 }; ///< Largest window, however well the API responds.
+    double backoffRatio{ 0.5 }; ///< Factor applied to the window on overload.
+    double latencySpikeFactor{ 2.0 }; ///< A response slower than this multiple of the smoothed latency counts as overload.
+};
+
+/**
+ * @class ConcurrencyLimiter
+ * @brief Adaptive limit on the number of transfers in flight (AIMD).
+ *
+ * Every response that completes normally grows the window by one transfer per window's
+ * worth of responses, so throughput probes upwards while latency is stable. A 429 or
+ * 503 response, or a latency above latencySpikeFactor times the smoothed latency, cuts
+ * the window by backoffRatio. Cuts are spaced by the smoothed latency, so a burst of
+ * overload responses to transfers already in flight cuts the window only once.
+ * The shared instance bounds the transfers of every GoogleBooksInterface of the process.
+ */
+class DLL_API ConcurrencyLimiter
+{
+public:
+    /**
+     * @class Permit
+     * @brief Holds one slot of the window for the duration of a transfer.
+     */
+    class Permit
+    {
+    public:
+        /**
+         * @brief Waits for a free slot and takes it.
+         * @param limiter The limiter to take the slot from.
+         */
+        explicit Permit(ConcurrencyLimiter& limiter) : m_limiter{ &limiter } { m_limiter->acquire(); }
+
+        /**
+         * @brief Waits for a free slot and takes it, unless the caller gives up first.
+         * @param limiter The limiter to take the slot from.
+         * @param deadline Time past which the wait is abandoned.
+         * @param cancellation Abandons the wait once cancelled.
+         */
+        Permit(ConcurrencyLimiter& limiter, std::chrono::steady_clock::time_point deadline, const CancellationToken& cancellation)
+            : m_limiter{ limiter.acquire(deadline, cancellation) ? &limiter : nullptr }
+        {
+        }
+
+        /**
+         * @brief Gives the slot back, without a sample unless complete() was called.
+         */
+        ~Permit()
+        {
+            if (m_limiter)
+                m_limiter->release();
+        }
+
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+
+        /**
+         * @brief Tells whether the slot was taken.
+         * @return False when the wait was abandoned, or once the slot was given back.
+         */
+        bool acquired() const noexcept { return m_limiter != nullptr; }
+
+        /**
+         * @brief Gives the slot back and feeds the outcome of the transfer to the window.
+         * @param status The HTTP status of the response.
+         * @param latency The duration of the transfer.
+         */
+        void complete(long status, std::chrono::nanoseconds latency)
+        {
+            m_limiter->release(status, latency);
+            m_limiter = nullptr;
+        }
+
+    private:
+        ConcurrencyLimiter* m_limiter; ///< The limiter the slot belongs to, null once released.
+    };
+
+    /**
+     * @brief Constructs a limiter.
+     * @param policy The bounds and reactivity of the window.
+     */
+    explicit ConcurrencyLimiter(const ConcurrencyPolicy& policy = {});
+
+    ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+    ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+    /**
+     * @brief Retrieves the limiter shared by every interface of the process.
+     * @return The shared limiter.
+     */
+    static ConcurrencyLimiter& shared();
+
+    /**
+     * @brief Replaces the policy and restarts the window from its initial limit.
+     * @param policy The new bounds and reactivity.
+     */
+    void setPolicy(const ConcurrencyPolicy& policy);
+
+    /**
+     * @brief Retrieves the current policy.
+     * @return A copy of the policy.
+     */
+    ConcurrencyPolicy policy() const;
+
+    /**
+     * @brief Retrieves the current window.
+     * @return The number of transfers allowed in flight, possibly fractional.
+     */
+    double limit() const;
+
+    /**
+     * @brief Retrieves the number of transfers in flight.
+     * @return The number of slots taken.
+     */
+    size_t inFlight() const;
+
+    /**
+     * @brief Waits until the window has a free slot and takes it.
+     * @param deadline Time past which the wait is abandoned; unbounded by default.
+     * @param cancellation Abandons the wait once cancelled, observed every few milliseconds.
+     * @return True when a slot was taken, false when the deadline passed or the caller cancelled first.
+     */
+    bool acquire(std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(),
+        const CancellationToken& cancellation = {});
+
+    /**
+     * @brief Gives a slot back without feeding the window, e.g. after a transport failure.
+     */
+    void release();
+
+    /**
+     * @brief Gives a slot back and adapts the window to the outcome of the transfer.
+     * @param status The HTTP status of the response.
+     * @param latency The duration of the transfer.
+     */
+    void release(long status, std::chrono::nanoseconds latency);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    mutable std::mutex m_mutex; ///< Guards the window and its statistics.
+    std::condition_variable m_slotFreed; ///< Signalled when a slot is released or the window grows.
+    ConcurrencyPolicy m_policy; ///< The bounds and reactivity of the window.
+    double m_limit; ///< The current window.
+    size_t m_inFlight{ 0 }; ///< Slots taken.
+    double m_smoothedLatency{ 0.0 }; ///< Exponentially weighted latency in nanoseconds, zero before the first sample.
+    Clock::time_point m_nextCut{}; ///< Earliest time of the next cut of the window.
+};
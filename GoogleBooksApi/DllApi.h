@@ -0,0 +1,9 @@
+#pragma once
+
+#ifdef GOOGLEBOOKSAPI_EXPORTS
+#define DLL_API __declspec(dllexport)
+#else
+#define DLL_API __declspec(dllimport)
+#endif // GOOGLEBOOKSAPI_EXPORTS
+
+#pragma warning(disable : 4251)
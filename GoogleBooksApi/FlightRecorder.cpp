@@ -0,0 +1,260 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif // _WIN32
+
+#include "FlightRecorder.h"
+
+using namespace std;
+
+namespace
+{
+    /**
+     * @class DumpLine
+     * @brief Formats one line of a dump in a stack buffer, without locale, stdio or allocation.
+     */
+    class DumpLine
+    {
+    public:
+        /**
+         * @brief Appends text, truncated when the line is full.
+         * @param text The NUL-terminated text.
+         * @return This line.
+         */
+        DumpLine& text(const char* text) noexcept
+        {
+            while (*text && m_size < sizeof(m_line))
+                m_line[m_size++] = *text++;
+
+            return *this;
+        }
+
+        /**
+         * @brief Appends an unsigned number.
+         * @param value The number.
+         * @param base 10 or 16.
+         * @param width The minimum number of digits, zero-padded.
+         * @return This line.
+         */
+        DumpLine& number(uint64_t value, unsigned base = 10, size_t width = 1) noexcept
+        {
+            char digits[20];
+            size_t count{ 0 };
+            do
+            {
+                digits[count++] = "0123456789abcdef"[value % base];
+                value /= base;
+            } while ((value != 0 || count < width) && count < sizeof(digits));
+
+            while (count > 0 && m_size < sizeof(m_line))
+                m_line[m_size++] = digits[--count];
+
+            return *this;
+        }
+
+        /**
+         * @brief Appends a signed decimal number.
+         * @param value The number.
+         * @return This line.
+         */
+        DumpLine& signedNumber(int64_t value) noexcept
+        {
+            if (value < 0)
+                return text("-").number(0 - static_cast<uint64_t>(value));
+
+            return number(static_cast<uint64_t>(value));
+        }
+
+        /**
+         * @brief Writes the line and empties it; a failed write drops the line.
+         * @param descriptor The file descriptor to write to.
+         */
+        void writeTo(int descriptor) noexcept
+        {
+            const char* data{ m_line };
+            auto left = m_size;
+            m_size = 0;
+
+            while (left > 0)
+            {
+#ifdef _WIN32
+                const auto written = _write(descriptor, data, static_cast<unsigned>(left));
+#else
+                const auto written = write(descriptor, data, left);
+#endif // _WIN32
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    return;
+
+                data += written;
+                left -= static_cast<size_t>(written);
+            }
+        }
+
+    private:
+        char m_line[512]; ///< The line; long enough for any record.
+        size_t m_size{ 0 }; ///< Characters in the line.
+    };
+}
+
+struct FlightRecorder::Slot
+{
+    static constexpr size_t words{ (sizeof(FlightRecord) + sizeof(uint64_t) - 1) / sizeof(uint64_t) }; ///< Words holding a record.
+
+    atomic<uint64_t> sequence{ 0 }; ///< Zero while empty, odd while written, 2 * sequence + 2 once the transfer is recorded.
+    array<atomic<uint64_t>, words> data{}; ///< The record.
+};
+
+FlightRecorder::FlightRecorder(size_t capacity)
+{
+    auto rounded = size_t{ 1 };
+    while (rounded < capacity)
+        rounded <<= 1;
+
+    m_slots = make_unique<Slot[]>(rounded);
+    m_mask = rounded - 1;
+}
+
+FlightRecorder::~FlightRecorder() = default;
+
+uint64_t FlightRecorder::hashResource(string_view resource)
+{
+    auto hash = uint64_t{ 14695981039346656037ull };
+    for (const auto c : resource)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+void FlightRecorder::record(string_view resource, chrono::system_clock::time_point started, chrono::nanoseconds elapsed,
+    long status, const TransferTiming& timing, string_view error)
+{
+    const auto sequence = m_next.fetch_add(1, memory_order_relaxed);
+
+    FlightRecord record;
+    record.sequence = sequence;
+    record.resourceHash = hashResource(resource);
+    record.startedAt = chrono::duration_cast<chrono::microseconds>(started.time_since_epoch());
+    record.elapsed = chrono::duration_cast<chrono::microseconds>(elapsed);
+    record.timing = timing;
+    record.status = status;
+    memcpy(record.error, error.data(), min(error.size(), sizeof(record.error) - 1));
+
+    uint64_t words[Slot::words]{};
+    memcpy(words, &record, sizeof(record));
+
+    // Claiming the slot keeps a writer that lapped the ring from copying into it at the same time;
+    // a record older than the one already there is dropped.
+    auto& slot = m_slots[sequence & m_mask];
+    auto current = slot.sequence.load(memory_order_relaxed);
+    for (;;)
+    {
+        if (current > 2 * sequence)
+            return;
+
+        if (current % 2 != 0)
+        {
+            this_thread::yield();
+            current = slot.sequence.load(memory_order_relaxed);
+        }
+        else if (slot.sequence.compare_exchange_weak(current, 2 * sequence + 1, memory_order_relaxed))
+            break;
+    }
+
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < Slot::words; ++i)
+        slot.data[i].store(words[i], memory_order_relaxed);
+
+    slot.sequence.store(2 * sequence + 2, memory_order_release);
+}
+
+bool FlightRecorder::read(uint64_t sequence, FlightRecord& record) const noexcept
+{
+    const auto& slot = m_slots[sequence & m_mask];
+    const auto expected = 2 * sequence + 2;
+
+    if (slot.sequence.load(memory_order_acquire) != expected)
+        return false;
+
+    uint64_t words[Slot::words];
+    for (size_t i = 0; i < Slot::words; ++i)
+        words[i] = slot.data[i].load(memory_order_relaxed);
+
+    // A writer lapping the ring changed the sequence before touching the data.
+    atomic_thread_fence(memory_order_acquire);
+    if (slot.sequence.load(memory_order_relaxed) != expected)
+        return false;
+
+    memcpy(&record, words, sizeof(record));
+
+    return true;
+}
+
+vector<FlightRecord> FlightRecorder::snapshot() const
+{
+    const auto next = recorded();
+    const auto first = next > capacity() ? next - capacity() : 0;
+
+    vector<FlightRecord> records;
+    records.reserve(static_cast<size_t>(next - first));
+
+    FlightRecord record;
+    for (auto sequence = first; sequence < next; ++sequence)
+    {
+        if (read(sequence, record))
+            records.push_back(record);
+    }
+
+    return records;
+}
+
+void FlightRecorder::dump(int descriptor) const noexcept
+{
+    const auto next = recorded();
+    const auto first = next > capacity() ? next - capacity() : 0;
+
+    // errno is the interrupted code's, and a signal handler must leave it as found.
+    const auto savedErrno = errno;
+
+    FlightRecord record;
+    DumpLine line;
+    for (auto sequence = first; sequence < next; ++sequence)
+    {
+        if (!read(sequence, record))
+            continue;
+
+        const auto started = record.startedAt.count();
+        const auto& timing = record.timing;
+
+        line.text("#").number(record.sequence)
+            .text(" started=").signedNumber(started / 1000000).text(".").number(static_cast<uint64_t>(started % 1000000), 10, 6)
+            .text(" resource=").number(record.resourceHash, 16, 16)
+            .text(" status=").signedNumber(record.status)
+            .text(" elapsed_us=").signedNumber(record.elapsed.count())
+            .text(" dns_us=").signedNumber(timing.nameLookup.count())
+            .text(" connect_us=").signedNumber(timing.connect.count())
+            .text(" tls_us=").signedNumber(timing.appConnect.count())
+            .text(" ttfb_us=").signedNumber(timing.startTransfer.count())
+            .text(" total_us=").signedNumber(timing.total.count())
+            .text(" bytes=").number(timing.bytesDownloaded)
+            .text(" reused=").number(timing.connectionReused ? 1 : 0)
+            .text(" error=\"").text(record.error).text("\"\n");
+        line.writeTo(descriptor);
+    }
+
+    errno = savedErrno;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "DllApi.h"
+#include "HttpTypes.h"
+
+/**
+ * @struct FlightRecord
+ * @brief What one transfer did, as kept by a FlightRecorder.
+ */
+struct FlightRecord
+{
+    std::uint64_t sequence{ 0 }; ///< Position of the transfer among those recorded, from 0.
+    std::uint64_t resourceHash{ 0 }; ///< Hash of the resource, see FlightRecorder::hashResource(); the URL itself, with its key, is not kept.
+    std::chrono::microseconds startedAt{ 0 }; ///< Wall-clock start of the transfer, since the Unix epoch.
+    std::chrono::microseconds elapsed{ 0 }; ///< Duration of the transfer as measured by the caller, failures included.
+    TransferTiming timing; ///< Phases, size and connection reuse, empty when the transfer failed.
+    long status{ 0 }; ///< The HTTP status code, 0 when no response was received.
+    char error[64]{}; ///< Beginning of the error message, empty on success.
+};
+
+/**
+ * @class FlightRecorder
+ * @brief Fixed-size, lock-free ring of the most recent transfers.
+ *
+ * Recording claims a slot with one atomic increment and copies the record into it
+ * under a per-slot sequence number, so writers never wait for a reader, nor for each
+ * other unless the ring laps a record still being copied, and nothing is allocated
+ * after construction. Readers copy every slot and
+ * drop the ones overwritten while they read them; a record is only lost when the ring
+ * wraps around during the copy. dump() formats each record on the stack and writes it
+ * with a single system call, so that a signal or crash handler may call it.
+ */
+class DLL_API FlightRecorder
+{
+public:
+    /**
+     * @brief Constructs an empty recorder.
+     * @param capacity The number of transfers kept, rounded up to a power of two.
+     */
+    explicit FlightRecorder(size_t capacity = 4096);
+
+    ~FlightRecorder();
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    /**
+     * @brief Computes the hash recorded for a resource, to find its transfers in a dump.
+     * @param resource The path and query relative to the API root.
+     * @return The 64-bit FNV-1a hash of the resource.
+     */
+    static std::uint64_t hashResource(std::string_view resource);
+
+    /**
+     * @brief Records a transfer, overwriting the oldest one when the ring is full.
+     * @param resource The path and query relative to the API root.
+     * @param started Wall-clock start of the transfer.
+     * @param elapsed Duration of the transfer.
+     * @param status The HTTP status code, 0 when no response was received.
+     * @param timing The timing of the transfer, empty when it failed.
+     * @param error The error message, empty on success; truncated to fit the record.
+     */
+    void record(std::string_view resource, std::chrono::system_clock::time_point started, std::chrono::nanoseconds elapsed,
+        long status, const TransferTiming& timing, std::string_view error = {});
+
+    /**
+     * @brief Retrieves the number of transfers kept.
+     * @return The capacity of the ring.
+     */
+    size_t capacity() const { return m_mask + 1; }
+
+    /**
+     * @brief Retrieves the number of transfers recorded since construction, including those overwritten.
+     * @return The number of calls to record().
+     */
+    std::uint64_t recorded() const { return m_next.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Copies the transfers still in the ring.
+     * @return The records, oldest first.
+     */
+    std::vector<FlightRecord> snapshot() const;
+
+    /**
+     * @brief Writes the transfers still in the ring, one line each, oldest first.
+     *
+     * Allocates nothing, takes no lock and bypasses stdio, using only async-signal-safe
+     * calls, so a signal or crash handler may call it.
+     * @param descriptor The file descriptor to write to, e.g. 2 for the standard error.
+     */
+    void dump(int descriptor) const noexcept;
+
+private:
+    /**
+     * @struct Slot
+     * @brief One record of the ring, copied word by word under a sequence number.
+     */
+    struct Slot;
+
+    std::unique_ptr<Slot[]> m_slots; ///< The ring.
+    size_t m_mask; ///< Capacity minus one, the capacity being a power of two.
+    std::atomic<std::uint64_t> m_next{ 0 }; ///< Sequence of the next transfer to record.
+
+    /**
+     * @brief Copies the record of a transfer if it is still in its slot.
+     * @param sequence The sequence of the transfer.
+     * @param record Receives the record.
+     * @return False when the slot is being written or holds another transfer.
+     */
+    bool read(std::uint64_t sequence, FlightRecord& record) const noexcept;
+};
@@ -4,12 +4,27 @@
 #include <curl/curl.h>
 #include <json/json.h>
 
+#include <memory>
 #include <string>
 #include <sstream>
 #include <algorithm>
-#include <unordered_map>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <exception>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif // _WIN32
 
 #include "GoogleBooksInterface.h"
+#include "Probes.h"
+#include "TraceScope.h"
+#include "UrlEncoder.h"
 
 #ifdef _DEBUG
 #    pragma comment (lib,"libcurl_debug.lib")
@@ -25,96 +40,786 @@
 
 using namespace std;
 
-GoogleBooksInterface::GoogleBooksInterface(const string& apiKey) : m_apiKey{ apiKey }, m_curl{ nullptr }, m_response{}
+namespace
 {
+    /**
+     * @brief Kind of a parsed response, as far as caching is concerned.
+     */
+    enum class ResponseKind
+    {
+        Volumes,
+        NotFound,
+        Error
+    };
+
+    /**
+     * @brief Tells volume pages apart from zero-result, not-found and error responses.
+     * @param books The parsed response.
+     * @return The kind of response.
+     */
+    ResponseKind classifyResponse(const Json::Value& books)
+    {
+        if (books.isNull())
+            return ResponseKind::Error;
+
+        if (!books.isObject())
+            return ResponseKind::Error;
+
+        if (books.isMember("error"))
+            return books["error"]["code"].asInt() == 404 ? ResponseKind::NotFound : ResponseKind::Error;
+
+        if (books["kind"].asString() == "books#volume")
+            return ResponseKind::Volumes;
+
+        if (books["totalItems"].asInt() == 0 || books["items"].empty())
+            return ResponseKind::NotFound;
+
+        return ResponseKind::Volumes;
+    }
+
+    /**
+     * @brief Rebuilds a response from a cached page.
+     * @param page The envelope and volumes of the response.
+     * @return The response as originally parsed.
+     */
+    Json::Value assemblePage(const CachedPage& page)
+    {
+        if (!page.envelope)
+            return page.volumes.empty() ? Json::Value{} : *page.volumes.front();
+
+        auto books = *page.envelope;
+
+        if (page.volumes.empty())
+            return books;
+
+        auto& items = books["items"];
+
+        for (Json::ArrayIndex i = 0; i < items.size() && i < page.volumes.size(); ++i)
+        {
+            auto item = *page.volumes[i];
+
+            for (const auto& name : items[i].getMemberNames())
+                item[name] = items[i][name];
+
+            items[i] = move(item);
+        }
+
+        return books;
+    }
+
+    /**
+     * @brief Wraps a single volume into a search response.
+     * @param volume The volume.
+     * @return A response with one item.
+     */
+    Json::Value singleVolumePage(const Json::Value& volume)
+    {
+        Json::Value books{ Json::objectValue };
+        books["kind"] = "books#volumes";
+        books["totalItems"] = 1;
+        books["items"].append(volume);
+
+        return books;
+    }
+
+    /**
+     * @brief Retrieves the value of the filter parameter.
+     * @param filter The availability filter, other than None.
+     * @return The parameter value.
+     */
+    const char* filterName(BooksQuery::Filter filter)
+    {
+        switch (filter)
+        {
+        case BooksQuery::Filter::Partial:
+            return "partial";
+        case BooksQuery::Filter::Full:
+            return "full";
+        case BooksQuery::Filter::FreeEbooks:
+            return "free-ebooks";
+        case BooksQuery::Filter::PaidEbooks:
+            return "paid-ebooks";
+        default:
+            return "ebooks";
+        }
+    }
+
+    /**
+     * @brief Retrieves the value of the printType parameter.
+     * @param printType The kind of publication.
+     * @return The parameter value.
+     */
+    const char* printTypeName(BooksQuery::PrintType printType)
+    {
+        switch (printType)
+        {
+        case BooksQuery::PrintType::Books:
+            return "books";
+        case BooksQuery::PrintType::Magazines:
+            return "magazines";
+        default:
+            return "all";
+        }
+    }
+
+    /**
+     * @brief Tells whether a resource asks for a partial representation of its volumes.
+     * @param resource The path and query relative to the API root.
+     * @return True when the resource selects fields or the lite projection.
+     */
+    bool isPartialResource(const string& resource)
+    {
+        return resource.find("projection=lite") != string::npos || resource.find("fields=") != string::npos;
+    }
+
+    /**
+     * @brief Retrieves the value of a header of the last response received on a handle.
+     * @param curl The CURL handle the transfer was performed on.
+     * @param name The header name, case insensitive.
+     * @return The header value, empty when the header is absent.
+     */
+    string responseHeader(CURL* curl, const char* name)
+    {
+        curl_header* header{ nullptr };
+
+        if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &header) != CURLHE_OK || !header)
+            return {};
+
+        return header->value;
+    }
+
+    /**
+     * @brief Tells whether a status is worth retrying.
+     * @param status The HTTP status code.
+     * @return True for 429 Too Many Requests and 5xx server errors.
+     */
+    bool isTransientStatus(long status)
+    {
+        return status == 429 || (status >= 500 && status < 600);
+    }
+
+    /**
+     * @brief Tells whether a transport failure is worth retrying.
+     * @param result The result of the transfer.
+     * @return True for connection failures and resets, timeouts and truncated responses.
+     */
+    bool isTransientFailure(CURLcode result)
+    {
+        switch (result)
+        {
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief Reads the Retry-After header of the last response received on a handle.
+     * @param curl The CURL handle the transfer was performed on.
+     * @return The requested wait, zero when the header is absent, malformed or in the past.
+     */
+    chrono::milliseconds retryAfterHeader(CURL* curl)
+    {
+        const auto value = responseHeader(curl, "Retry-After");
+        if (value.empty())
+            return {};
+
+        if (all_of(value.begin(), value.end(), [](unsigned char c) { return isdigit(c); }))
+            return value.size() < 10 ? chrono::seconds{ stoll(value) } : chrono::hours{ 24 };
+
+        const auto date = curl_getdate(value.c_str(), nullptr);
+        const auto now = time(nullptr);
+        if (date < 0 || date <= now)
+            return {};
+
+        return chrono::seconds{ date - now };
+    }
+
+    /**
+     * @brief Reads where the time of the last transfer performed on a handle went.
+     * @param curl The CURL handle the transfer was performed on.
+     * @return The phases, size and connection reuse of the transfer.
+     */
+    TransferTiming transferTiming(CURL* curl)
+    {
+        const auto phase = [curl](CURLINFO info)
+            {
+                curl_off_t microseconds{ 0 };
+                curl_easy_getinfo(curl, info, &microseconds);
+                return chrono::microseconds{ microseconds };
+            };
+
+        TransferTiming timing;
+        timing.nameLookup = phase(CURLINFO_NAMELOOKUP_TIME_T);
+        timing.connect = phase(CURLINFO_CONNECT_TIME_T);
+        timing.appConnect = phase(CURLINFO_APPCONNECT_TIME_T);
+        timing.startTransfer = phase(CURLINFO_STARTTRANSFER_TIME_T);
+        timing.total = phase(CURLINFO_TOTAL_TIME_T);
+
+        curl_off_t bytes{ 0 };
+        curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+        timing.bytesDownloaded = static_cast<uint64_t>(bytes);
+
+        long connects{ 0 };
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+        timing.connectionReused = connects == 0;
+
+        return timing;
+    }
+
+    /**
+     * @brief Socket option callback counting the connections opened by CURL.
+     * @param metrics The metrics of the interface.
+     * @param purpose What the socket is for.
+     * @return CURL_SOCKOPT_OK to let the connection proceed.
+     */
+    int countOpenedConnection(void* metrics, curl_socket_t, curlsocktype purpose)
+    {
+        if (purpose == CURLSOCKTYPE_IPCXN)
+            static_cast<ClientMetrics*>(metrics)->connectionOpened();
+
+        return CURL_SOCKOPT_OK;
+    }
+
+    /**
+     * @brief Socket close callback counting the connections closed by CURL.
+     * @param metrics The metrics of the interface.
+     * @param socket The socket to close.
+     * @return The result of closing the socket.
+     */
+    int closeConnection(void* metrics, curl_socket_t socket)
+    {
+        static_cast<ClientMetrics*>(metrics)->connectionClosed();
+#ifdef _WIN32
+        return closesocket(socket);
+#else
+        return close(socket);
+#endif // _WIN32
+    }
+
+    /**
+     * @brief Callback function for writing data received from CURL.
+     * @param contents The data received.
+     * @param size The size of each data element.
+     * @param nmemb The number of data elements.
+     * @param userContent The user content to write to.
+     * @return The number of bytes written.
+     */
+    size_t writeCallback(void* contents, size_t size, size_t nmemb, string* userContent)
+    {
+        const size_t realsize{ size * nmemb };
+
+        if (!userContent)
+            return 0;
+
+        if (userContent->empty() && realsize > 0)
+            GOOGLEBOOKS_PROBE0(first_byte);
+
+        userContent->append((char*)contents, realsize);
+
+        return realsize;
+    }
+
+    /**
+     * @brief Resolver callback counting the host names CURL could not find in its DNS cache.
+     * @param resolves The count of the transfer in progress, or null.
+     * @return Zero to let the resolution proceed.
+     */
+    int countResolve(void*, void*, void* resolves)
+    {
+        if (resolves)
+            ++*static_cast<int*>(resolves);
+
+        return 0;
+    }
+
+    /**
+     * @class Scratch
+     * @brief Lends the calling thread's instance of a reusable object to one call at a time.
+     *
+     * The instance keeps its storage from one call to the next. A call made while it is
+     * lent, e.g. by an override of httpRequest() or parseResponse() searching again on the
+     * same thread, gets an object of its own instead, so the outer call's is never clobbered.
+     * @tparam T A type with a clear() member emptying it but keeping its storage.
+     */
+    template <typename T>
+    class Scratch
+    {
+    public:
+        /**
+         * @brief Borrows the thread's instance if it is free, emptied.
+         */
+        Scratch()
+        {
+            auto& slot = threadSlot();
+            if (slot.lent)
+                m_own.emplace();
+            else
+            {
+                slot.lent = true;
+                slot.value.clear();
+            }
+        }
+
+        /**
+         * @brief Gives the thread's instance back, if it was borrowed.
+         */
+        ~Scratch()
+        {
+            if (!m_own)
+                threadSlot().lent = false;
+        }
+
+        Scratch(const Scratch&) = delete;
+        Scratch& operator=(const Scratch&) = delete;
+
+        T& operator*() { return m_own ? *m_own : threadSlot().value; }
+        T* operator->() { return &**this; }
+
+    private:
+        /**
+         * @struct Slot
+         * @brief The thread's instance and whether a call holds it.
+         */
+        struct Slot
+        {
+            T value; ///< The reusable object.
+            bool lent{ false }; ///< Whether a Scratch holds it.
+        };
+
+        std::optional<T> m_own; ///< Object of a nested call, empty when the thread's instance is borrowed.
+
+        static Slot& threadSlot()
+        {
+            thread_local Slot slot;
+            return slot;
+        }
+    };
+
+    /**
+     * @brief Borrows the calling thread's buffer for the resource being requested.
+     * @return The buffer, emptied but with the capacity of earlier requests.
+     */
+    Scratch<string> resourceBuffer()
+    {
+        return {};
+    }
+
+    /**
+     * @brief Retrieves the calling thread's buffer for response bodies.
+     *
+     * The transport swaps it into the response it returns and the body is swapped back
+     * once parsed, so its capacity survives from one request to the next.
+     * @return The buffer.
+     */
+    string& bodyBuffer()
+    {
+        thread_local string body;
+        return body;
+    }
+
+    /**
+     * @brief Borrows the calling thread's query for the single-qualifier search methods.
+     *
+     * The query stays lent until the end of the full expression, so it outlives the search it is passed to.
+     * @return The query, emptied but with the storage of earlier searches.
+     */
+    Scratch<BooksQuery> reusableQuery()
+    {
+        return {};
+    }
+
+    /**
+     * @brief Throws when the caller of a request cancelled it or its deadline passed.
+     * @param deadline The deadline of the call.
+     * @param cancellation The cancellation token of the call.
+     */
+    void throwIfAbandoned(chrono::steady_clock::time_point deadline, const CancellationToken& cancellation)
+    {
+        if (cancellation.cancelled())
+            throw GoogleBooksCancelledException{ "Request cancelled", false };
+
+        if (deadline != chrono::steady_clock::time_point::max() && chrono::steady_clock::now() >= deadline)
+            throw GoogleBooksCancelledException{ "Deadline exceeded", true };
+    }
+
+    /**
+     * @brief Waits for a lock, unless the caller of the request gives up first.
+     *
+     * Nothing signals a cancellation, so a cancellable caller wakes up periodically to check it.
+     * @param lock The lock to take, not held.
+     * @param deadline The deadline of the call.
+     * @param cancellation The cancellation token of the call.
+     * @return True once the lock is held, false when the deadline passed or the caller cancelled first.
+     */
+    bool lockUnlessAbandoned(unique_lock<recursive_timed_mutex>& lock, chrono::steady_clock::time_point deadline,
+        const CancellationToken& cancellation)
+    {
+        constexpr chrono::milliseconds cancellationPoll{ 10 };
+
+        if (deadline == chrono::steady_clock::time_point::max() && !cancellation.cancellable())
+        {
+            lock.lock();
+            return true;
+        }
+
+        while (!cancellation.cancelled())
+        {
+            const auto now = chrono::steady_clock::now();
+            if (now >= deadline)
+                return false;
+
+            if (lock.try_lock_until(cancellation.cancellable() ? min(deadline, now + cancellationPoll) : deadline))
+                return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Progress callback aborting a transfer whose caller cancelled it or whose deadline passed.
+     * @param request The request being transferred, or null.
+     * @return Non-zero to abort the transfer.
+     */
+    int abortAbandoned(void* request, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+    {
+        if (!request)
+            return 0;
+
+        const auto& abandoned = *static_cast<const HttpRequest*>(request);
+        return abandoned.cancellation.cancelled() || chrono::steady_clock::now() >= abandoned.deadline;
+    }
+
+    /**
+     * @brief Bounds a timeout by the time left until a deadline.
+     * @param timeout The timeout, zero for none.
+     * @param deadline The deadline of the call.
+     * @param now The current time.
+     * @return The timeout in milliseconds for CURL, zero for none.
+     */
+    long boundedTimeout(chrono::milliseconds timeout, chrono::steady_clock::time_point deadline, chrono::steady_clock::time_point now)
+    {
+        if (deadline != chrono::steady_clock::time_point::max())
+        {
+            // Zero would disable the timeout, so an imminent deadline still gets a millisecond.
+            const auto remaining = max(chrono::ceil<chrono::milliseconds>(deadline - now), chrono::milliseconds{ 1 });
+            timeout = timeout.count() > 0 ? min(timeout, remaining) : remaining;
+        }
+
+        return static_cast<long>(timeout.count());
+    }
+
+    /**
+     * @brief Retrieves the message of the exception being handled.
+     * @return The message, valid while the exception is handled.
+     */
+    string_view currentExceptionMessage()
+    {
+        try
+        {
+            throw;
+        }
+        catch (const exception& e)
+        {
+            return e.what();
+        }
+        catch (...)
+        {
+            return "Unknown exception";
+        }
+    }
+
+    /**
+     * @brief Appends the decimal representation of a number to a string.
+     * @param number The number.
+     * @param out The string to append to.
+     */
+    void appendNumber(int number, string& out)
+    {
+        char digits[16];
+        const auto last = to_chars(begin(digits), end(digits), number).ptr;
+        out.append(digits, last);
+    }
+}
+
+GoogleBooksInterface::GoogleBooksInterface(const string& apiKey) : m_apiKey{ apiKey }, m_curl{ nullptr }, m_multi{ nullptr }, m_share{ nullptr }, m_hedgeCurl{ nullptr },
+    m_refresher{ [this](const string& resource) { refreshQuery(resource); } }
+{
+    m_urlTemplate.setApiKey(apiKey);
     initCurl();
 }
 
-GoogleBooksInterface::GoogleBooksInterface() : m_apiKey{}, m_curl{ nullptr }, m_response{}
+GoogleBooksInterface::GoogleBooksInterface() : m_apiKey{}, m_curl{ nullptr }, m_multi{ nullptr }, m_share{ nullptr }, m_hedgeCurl{ nullptr },
+    m_refresher{ [this](const string& resource) { refreshQuery(resource); } }
 {
     initCurl();
 }
 
 GoogleBooksInterface::~GoogleBooksInterface()
 {
+    m_refresher.stop();
+
+    if (m_multi)
+        curl_multi_cleanup(m_multi);
+
     if (m_curl)
         curl_easy_cleanup(m_curl);
+
+    // The pool closes its connections last, while the metrics counting them are alive.
+    if (m_share)
+        curl_share_cleanup(m_share);
 }
 
 void GoogleBooksInterface::setApiKey(const string& apiKey)
 {
+    lock_guard<recursive_timed_mutex> lock(m_curlMutex);
     m_apiKey = apiKey;
+    m_urlTemplate.setApiKey(apiKey);
 }
 
-Json::Value GoogleBooksInterface::getAllBooksByTerm(const string& term, int startIndex, int maxResults)
+void GoogleBooksInterface::setRetryPolicy(const RetryPolicy& policy)
 {
-    const string t = escapeString(term) +
-        +"&startIndex=" + to_string(startIndex)
-        + "&maxResults=" + to_string(maxResults);
+    lock_guard<mutex> lock(m_settingsMutex);
+    m_retryPolicy = policy;
+}
 
-    auto response = httpGet(t);
+void GoogleBooksInterface::setHedgePolicy(const HedgePolicy& policy)
+{
+    m_hedging.setPolicy(policy);
+}
 
-    if (!response.empty())
-        return parseResponse(response);
+void GoogleBooksInterface::setCircuitBreakerPolicy(const CircuitPolicy& policy)
+{
+    m_breaker.setPolicy(policy);
+}
 
-    return {};
+void GoogleBooksInterface::setTimeoutPolicy(const TimeoutPolicy& policy)
+{
+    lock_guard<mutex> lock(m_settingsMutex);
+    m_timeouts = policy;
 }
 
-Json::Value GoogleBooksInterface::getAllBooksBySubject(const string& term, const string& subject, int startIndex, int maxResults)
+void GoogleBooksInterface::setTracer(shared_ptr<Tracer> tracer)
 {
-    const string t = escapeString(term)
-        + "+subject:" + escapeString(subject) +
-        + "&startIndex=" + to_string(startIndex)
-        + "&maxResults=" + to_string(maxResults);
+    lock_guard<mutex> lock(m_settingsMutex);
+    m_tracing.store(tracer != nullptr, memory_order_relaxed);
+    m_tracer = move(tracer);
+}
 
-    auto response = httpGet(t);
+void GoogleBooksInterface::setEndpoint(const string& endpoint)
+{
+    {
+        lock_guard<recursive_timed_mutex> lock(m_curlMutex);
+        if (!m_urlTemplate.setEndpoint(endpoint))
+            throw GoogleBooksInterfaceException{ "Invalid endpoint URL: " + endpoint };
+    }
 
-    if (!response.empty())
-        return parseResponse(response);
+    clearCache();
+}
 
-    return {};
+void GoogleBooksInterface::setCachePolicy(const CachePolicy& policy)
+{
+    m_queryCache.setPolicy(policy);
+    m_volumeCache.setPolicy(policy);
 }
 
-Json::Value GoogleBooksInterface::getAllBooksByTitle(const string& term, const string& bookTitle, int startIndex, int maxResults)
+LatencyHistogram& GoogleBooksInterface::latency(LatencyOperation operation)
 {
-    const string t = escapeString(term )
-        + "+intitle:" + escapeString(bookTitle)
-        + "&startIndex=" + to_string(startIndex)
-        + "&maxResults=" + to_string(maxResults);
+    return m_metrics.latency(operation);
+}
 
-    auto response = httpGet(t);
+string GoogleBooksInterface::prometheusMetrics() const
+{
+    return m_metrics.render();
+}
 
-    if (!response.empty())
-        return parseResponse(response);
+ConnectionStats GoogleBooksInterface::connectionStats() const
+{
+    return m_metrics.connectionStats();
+}
 
-    return {};
+const FlightRecorder& GoogleBooksInterface::flightRecorder() const
+{
+    return m_flightRecorder;
 }
 
-Json::Value GoogleBooksInterface::getAllBooksByAuthor(const string& term, const string& author, int startIndex, int maxResults)
+void GoogleBooksInterface::clearCache()
 {
-    const string t = escapeString(term)
-        + "+inauthor:" + escapeString(author)
-        + "&startIndex=" + to_string(startIndex)
-        + "&maxResults=" + to_string(maxResults);
+    m_queryCache.clear();
+    m_volumeCache.clear();
+}
 
-    auto response = httpGet(t);
+shared_ptr<Tracer> GoogleBooksInterface::tracer()
+{
+    if (!m_tracing.load(memory_order_relaxed))
+        return nullptr;
 
-    if (!response.empty())
-        return parseResponse(response);
-    
-    return {};
+    lock_guard<mutex> lock(m_settingsMutex);
+    return m_tracer;
+}
+
+template <typename Call>
+Json::Value GoogleBooksInterface::measure(LatencyOperation operation, Call&& call)
+{
+    LatencyHistogram::Timer timer{ m_metrics.latency(operation) };
+    TraceScope span{ tracer(), "googlebooks.search" };
+    span.setAttribute("googlebooks.method", latencyOperationName(operation));
+
+    try
+    {
+        auto books = call();
+        const auto failed = books.isNull() || (books.isObject() && books.isMember("error"));
+        m_metrics.recordRequest(operation, failed ? RequestOutcome::ApiError : RequestOutcome::Success);
+
+        if (failed)
+            span.setError("Error response");
+
+        return books;
+    }
+    catch (...)
+    {
+        m_metrics.recordRequest(operation, RequestOutcome::Failure);
+        span.setError(currentExceptionMessage());
+        throw;
+    }
+}
+
+Json::Value GoogleBooksInterface::getAllBooksByTerm(const string& term, int startIndex, int maxResults)
+{
+    return getAllBooksByTerm(term, SearchOptions{}, startIndex, maxResults);
+}
+
+Json::Value GoogleBooksInterface::getAllBooksBySubject(const string& term, const string& subject, int startIndex, int maxResults)
+{
+    return getAllBooksBySubject(term, subject, SearchOptions{}, startIndex, maxResults);
+}
+
+Json::Value GoogleBooksInterface::getAllBooksByTitle(const string& term, const string& bookTitle, int startIndex, int maxResults)
+{
+    return getAllBooksByTitle(term, bookTitle, SearchOptions{}, startIndex, maxResults);
+}
+
+Json::Value GoogleBooksInterface::getAllBooksByAuthor(const string& term, const string& author, int startIndex, int maxResults)
+{
+    return getAllBooksByAuthor(term, author, SearchOptions{}, startIndex, maxResults);
 }
 
 Json::Value GoogleBooksInterface::getAllBooksByIsbn(const string& ISBN, int startIndex, int maxResults)
 {
-    const string term = "isbn:" + escapeString(ISBN);
+    return getAllBooksByIsbn(ISBN, SearchOptions{}, startIndex, maxResults);
+}
 
-    auto response = httpGet(term);
+Json::Value GoogleBooksInterface::getAllBooksByTerm(const string& term, const SearchOptions& options, int startIndex, int maxResults)
+{
+    return measure(LatencyOperation::Term, [&]
+        {
+            return runQuery(reusableQuery()->term(term).startIndex(startIndex).maxResults(maxResults).options(options));
+        });
+}
 
-    if (!response.empty())
-        return parseResponse(response);
+Json::Value GoogleBooksInterface::getAllBooksBySubject(const string& term, const string& subject, const SearchOptions& options, int startIndex, int maxResults)
+{
+    return measure(LatencyOperation::Subject, [&]
+        {
+            return runQuery(reusableQuery()->term(term).subject(subject).startIndex(startIndex).maxResults(maxResults).options(options));
+        });
+}
 
-    return {};
+Json::Value GoogleBooksInterface::getAllBooksByTitle(const string& term, const string& bookTitle, const SearchOptions& options, int startIndex, int maxResults)
+{
+    return measure(LatencyOperation::Title, [&]
+        {
+            return runQuery(reusableQuery()->term(term).inTitle(bookTitle).startIndex(startIndex).maxResults(maxResults).options(options));
+        });
+}
+
+Json::Value GoogleBooksInterface::getAllBooksByAuthor(const string& term, const string& author, const SearchOptions& options, int startIndex, int maxResults)
+{
+    return measure(LatencyOperation::Author, [&]
+        {
+            return runQuery(reusableQuery()->term(term).inAuthor(author).startIndex(startIndex).maxResults(maxResults).options(options));
+        });
+}
+
+Json::Value GoogleBooksInterface::getAllBooksByIsbn(const string& ISBN, const SearchOptions& options, int startIndex, int maxResults)
+{
+    return measure(LatencyOperation::Isbn, [&]
+        {
+            // A cached volume is complete, so it only stands in for the first page of a full response,
+            // as a page of its own: the totals and searchInfo of the search are not known here.
+            if (options.fields.empty() && options.projection == VolumeProjection::Full && startIndex == 0 && maxResults > 0)
+            {
+                auto volume = m_volumeCache.findByIsbn(ISBN, VolumeSource::Search);
+                m_metrics.recordCacheLookup(CacheKind::Volume, volume != nullptr);
+
+                if (volume)
+                {
+                    throwIfAbandoned(options.deadline, options.cancellation);
+
+                    if (options.timing)
+                        *options.timing = {};
+
+                    return singleVolumePage(*volume);
+                }
+            }
+
+            return runQuery(reusableQuery()->isbn(ISBN).startIndex(startIndex).maxResults(maxResults).options(options));
+        });
+}
+
+Json::Value GoogleBooksInterface::search(const BooksQuery& query)
+{
+    return measure(LatencyOperation::Query, [&]
+        {
+            return runQuery(query);
+        });
+}
+
+Json::Value GoogleBooksInterface::runQuery(const BooksQuery& query)
+{
+    if (query.empty())
+        throw GoogleBooksInterfaceException{ "Query has neither a term nor a qualifier" };
+
+    auto resource = resourceBuffer();
+    buildResource(query, *resource);
+
+    if (auto span = TraceScope::current())
+    {
+        span->setAttribute("googlebooks.start_index", static_cast<int64_t>(query.startIndex().value_or(0)));
+        span->setAttribute("googlebooks.max_results", static_cast<int64_t>(query.maxResults().value_or(10)));
+    }
+
+    return fetchBooks(*resource, query.options());
+}
+
+Json::Value GoogleBooksInterface::getVolumeById(const string& volumeId, VolumeProjection projection)
+{
+    return measure(LatencyOperation::Volume, [&]
+        {
+            // A search item lacks some details of the full volume, which only a lite lookup can do without.
+            auto volume = m_volumeCache.findById(volumeId, projection == VolumeProjection::Lite ? VolumeSource::Lite : VolumeSource::Volume);
+            m_metrics.recordCacheLookup(CacheKind::Volume, volume != nullptr);
+
+            if (volume)
+                return *volume;
+
+            auto resource = resourceBuffer();
+            *resource += "volumes/";
+            UrlEncoder::append(volumeId, *resource);
+            if (projection == VolumeProjection::Lite)
+                *resource += "?projection=lite";
+
+            return fetchBooks(*resource);
+        });
 }
 
 void GoogleBooksInterface::initCurl()
@@ -123,6 +828,320 @@ void GoogleBooksInterface::initCurl()
     m_curl = curl_easy_init();
     if (!m_curl)
         throw GoogleBooksInterfaceException{ "Failed to initialize CURL" };
+
+    curl_easy_setopt(m_curl, CURLOPT_XFERINFOFUNCTION, abortAbandoned);
+    curl_easy_setopt(m_curl, CURLOPT_NOPROGRESS, 0L);
+
+    // Every handle of the share is driven under m_curlMutex, so the share needs no lock callbacks.
+    if (!m_share && (m_share = curl_share_init()) != nullptr)
+    {
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    curl_easy_setopt(m_curl, CURLOPT_SHARE, m_share);
+    curl_easy_setopt(m_curl, CURLOPT_SOCKOPTFUNCTION, countOpenedConnection);
+    curl_easy_setopt(m_curl, CURLOPT_SOCKOPTDATA, &m_metrics);
+    curl_easy_setopt(m_curl, CURLOPT_CLOSESOCKETFUNCTION, closeConnection);
+    curl_easy_setopt(m_curl, CURLOPT_CLOSESOCKETDATA, &m_metrics);
+    curl_easy_setopt(m_curl, CURLOPT_RESOLVER_START_FUNCTION, countResolve);
+}
+
+Json::Value GoogleBooksInterface::fetchBooks(const string& resource, const SearchOptions& options)
+{
+    auto cached = m_queryCache.find(resource);
+    m_metrics.recordCacheLookup(CacheKind::Query, static_cast<bool>(cached));
+
+    if (auto span = TraceScope::current())
+        span->setAttribute("googlebooks.cache", cached ? "hit" : "miss");
+
+    if (cached)
+    {
+        if (cached.stale)
+            m_refresher.schedule(resource);
+
+        if (options.timing)
+            *options.timing = {};
+
+        return assemblePage(*cached.value);
+    }
+
+    const auto fetch = [this, &resource, &options]
+        {
+            // A fetch for the same resource may have completed between the lookup above and now.
+            if (auto cached = m_queryCache.find(resource); cached && !cached.stale)
+                return Fetched{ make_shared<const Json::Value>(assemblePage(*cached.value)) };
+
+            return fetchAndStore(resource, options);
+        };
+
+    const auto abandoned = [&options]
+        {
+            throwIfAbandoned(options.deadline, options.cancellation);
+            return Fetched{};
+        };
+
+    for (;;)
+    {
+        try
+        {
+            auto fetched = m_inFlight.run(resource, fetch, options.deadline, options.cancellation, abandoned);
+
+            if (options.timing)
+                *options.timing = fetched.timing;
+
+            return *fetched.books;
+        }
+        catch (const GoogleBooksCancelledException&)
+        {
+            // The shared fetch may have been abandoned on behalf of another caller.
+            throwIfAbandoned(options.deadline, options.cancellation);
+        }
+    }
+}
+
+GoogleBooksInterface::Fetched GoogleBooksInterface::fetchAndStore(const string& resource, const SearchOptions& options)
+{
+    HttpRequest request{ resource };
+    request.deadline = options.deadline;
+    request.cancellation = options.cancellation;
+
+    auto cached = m_queryCache.peek(resource);
+    if (cached)
+        request.conditional = cached.validators;
+
+    HttpResponse response;
+    try
+    {
+        response = transferWithRetries(request);
+    }
+    catch (const GoogleBooksCircuitOpenException&)
+    {
+        // An old answer beats none while the API is down.
+        if (!cached || m_breaker.policy().fallback != CircuitFallback::ServeCached)
+            throw;
+
+        return { make_shared<const Json::Value>(assemblePage(*cached.value)) };
+    }
+
+    if (response.notModified() && cached)
+    {
+        auto validators = response.validators.empty() ? cached.validators : response.validators;
+        m_queryCache.store(resource, cached.value, cached.value->volumes.empty(), validators);
+
+        return { make_shared<const Json::Value>(assemblePage(*cached.value)), response.timing };
+    }
+
+    if (response.body.empty())
+        return { make_shared<const Json::Value>(), response.timing };
+
+    shared_ptr<const Json::Value> books;
+    {
+        LatencyHistogram::Timer timer{ m_metrics.latency(LatencyOperation::Parse) };
+        TraceScope span{ "googlebooks.parse" };
+        span.setAttribute("googlebooks.bytes", static_cast<int64_t>(response.body.size()));
+
+        books = make_shared<const Json::Value>(parseResponse(response.body));
+    }
+
+    // Hand the body's storage back to the transport for the next request of this thread.
+    bodyBuffer().swap(response.body);
+
+    switch (classifyResponse(*books))
+    {
+    case ResponseKind::Volumes:
+        m_queryCache.store(resource, splitPage(*books, !isPartialResource(resource)), false, response.validators);
+        break;
+    case ResponseKind::NotFound:
+        m_queryCache.store(resource, splitPage(*books, !isPartialResource(resource)), true, response.validators);
+        break;
+    case ResponseKind::Error:
+        break;
+    }
+
+    return { move(books), response.timing };
+}
+
+HttpResponse GoogleBooksInterface::transferWithRetries(const HttpRequest& request)
+{
+    RetryPolicy policy;
+    {
+        lock_guard<mutex> lock(m_settingsMutex);
+        policy = m_retryPolicy;
+    }
+
+    auto& budget = RetryBudget::shared();
+    budget.recordRequest();
+
+    for (auto attempt = 1;; ++attempt)
+    {
+        HttpResponse response;
+        exception_ptr failure;
+
+        try
+        {
+            response = transfer(request);
+
+            if (!isTransientStatus(response.status))
+                return response;
+        }
+        catch (const GoogleBooksTransportException& e)
+        {
+            if (!e.transient())
+                throw;
+
+            failure = current_exception();
+        }
+
+        const auto delay = policy.backoff(attempt, response.retryAfter);
+        const auto pastDeadline = request.deadline != chrono::steady_clock::time_point::max() &&
+            chrono::steady_clock::now() + delay >= request.deadline;
+
+        if (attempt >= policy.maxAttempts || delay.count() < 0 || pastDeadline || !budget.tryWithdraw())
+        {
+            if (failure)
+                rethrow_exception(failure);
+
+            return response;
+        }
+
+        m_metrics.recordRetry();
+        this_thread::sleep_for(delay);
+    }
+}
+
+HttpResponse GoogleBooksInterface::transfer(const HttpRequest& request)
+{
+    throwIfAbandoned(request.deadline, request.cancellation);
+
+    if (!m_breaker.allow())
+        throw GoogleBooksCircuitOpenException{ "Circuit breaker open" };
+
+    HttpResponse response;
+    try
+    {
+        unique_lock<recursive_timed_mutex> transport{ m_curlMutex, defer_lock };
+        optional<ConcurrencyLimiter::Permit> permit;
+        {
+            TraceScope queue{ "googlebooks.queue" };
+
+            if (!RateLimiter::shared().acquire(request.deadline))
+                throw GoogleBooksInterfaceException{ "Rate limit exceeded" };
+
+            // The transport of this instance is taken first, so that a transfer slot is never held, and no
+            // latency measured, while waiting for another transfer of the same instance to finish.
+            if (!lockUnlessAbandoned(transport, request.deadline, request.cancellation))
+                throwIfAbandoned(request.deadline, request.cancellation);
+
+            permit.emplace(ConcurrencyLimiter::shared(), request.deadline, request.cancellation);
+            if (!permit->acquired())
+                throwIfAbandoned(request.deadline, request.cancellation);
+        }
+
+        const auto startedAt = chrono::system_clock::now();
+        const auto started = chrono::steady_clock::now();
+        TraceScope span{ "googlebooks.transport" };
+
+        m_metrics.transferStarted();
+        try
+        {
+            response = httpRequest(request);
+        }
+        catch (...)
+        {
+            const auto elapsed = chrono::steady_clock::now() - started;
+            m_metrics.transferFinished({});
+            m_metrics.latency(LatencyOperation::Transfer).record(elapsed);
+            m_flightRecorder.record(request.resource, startedAt, elapsed, 0, {}, currentExceptionMessage());
+            span.setError(currentExceptionMessage());
+            throw;
+        }
+
+        const auto elapsed = chrono::steady_clock::now() - started;
+
+        response.timing.transferred = true;
+        // Transports that report no size are credited with the body they returned.
+        if (response.timing.bytesDownloaded == 0)
+            response.timing.bytesDownloaded = response.body.size();
+
+        m_metrics.transferFinished(response.timing);
+        m_metrics.latency(LatencyOperation::Transfer).record(elapsed);
+        m_flightRecorder.record(request.resource, startedAt, elapsed, response.status, response.timing);
+        permit->complete(response.status, elapsed);
+
+        span.setAttribute("http.response.status_code", static_cast<int64_t>(response.status));
+        span.setAttribute("googlebooks.bytes", static_cast<int64_t>(response.timing.bytesDownloaded));
+        span.setAttribute("googlebooks.connection_reused", static_cast<int64_t>(response.timing.connectionReused));
+    }
+    catch (const GoogleBooksTransportException&)
+    {
+        m_breaker.record(false);
+        throw;
+    }
+    catch (...)
+    {
+        // The request never reached the API, so it tells nothing about its health.
+        m_breaker.abandon();
+        throw;
+    }
+
+    m_breaker.record(!isTransientStatus(response.status));
+
+    return response;
+}
+
+shared_ptr<const CachedPage> GoogleBooksInterface::splitPage(const Json::Value& books, bool intern)
+{
+    auto page = make_shared<CachedPage>();
+
+    if (books["kind"].asString() == "books#volume")
+    {
+        auto shared = intern ? m_volumeCache.store(books, VolumeSource::Volume) : nullptr;
+        page->volumes.push_back(shared ? shared : make_shared<const Json::Value>(books));
+
+        return page;
+    }
+    Json::Value envelope{ Json::objectValue };
+
+    for (const auto& name : books.getMemberNames())
+    {
+        if (name != "items")
+            envelope[name] = books[name];
+    }
+
+    for (const auto& item : books["items"])
+    {
+        Json::Value queryMembers{ Json::objectValue };
+        Json::Value volume = item;
+
+        if (volume.isMember("searchInfo"))
+        {
+            queryMembers["searchInfo"] = volume["searchInfo"];
+            volume.removeMember("searchInfo");
+        }
+
+        auto shared = intern ? m_volumeCache.store(move(volume), VolumeSource::Search) : nullptr;
+        if (!shared)
+        {
+            // Partial items and items without an id are not shared and are kept whole in the envelope.
+            shared = make_shared<const Json::Value>(Json::objectValue);
+            queryMembers = item;
+        }
+
+        envelope["items"].append(move(queryMembers));
+        page->volumes.push_back(move(shared));
+    }
+
+    page->envelope = make_shared<const Json::Value>(move(envelope));
+
+    return page;
+}
+
+void GoogleBooksInterface::refreshQuery(const string& resource)
+{
+    TraceScope span{ tracer(), "googlebooks.refresh" };
+    m_inFlight.run(resource, [this, &resource] { return fetchAndStore(resource); });
 }
 
 string GoogleBooksInterface::replaceSpaces(string str, const char sign)
@@ -131,47 +1150,147 @@ string GoogleBooksInterface::replaceSpaces(string str, const char sign)
     return str;
 }
 
-string GoogleBooksInterface::escapeString(const string& data)
+void GoogleBooksInterface::buildResource(const BooksQuery& query, string& resource)
 {
-    string buffer;
-    buffer.reserve(data.size() * 2);
+    resource += "volumes?q=";
+    UrlEncoder::append(query.term(), resource);
 
-    static const unordered_map<char, string> html_entities =
+    for (const auto& qualifier : query.qualifiers())
     {
-        {'&', "&amp;"},
-        {'<', "&lt;"},
-        {'>', "&gt;"},
-        {'"', "&quot;"},
-        {'\'', "&#39;"},
-        {' ', "+"}
-    };
+        if (resource.back() != '=')
+            resource += '+';
 
-    for_each(data.begin(), data.end(), [&](char c)
-        {
-            if (auto it = html_entities.find(c); it != html_entities.end())
-                buffer += it->second;
-            else
-                buffer += c;
-        });
+        resource += qualifier.keyword;
+        resource += ':';
+        UrlEncoder::append(qualifier.value, resource);
+    }
+
+    if (query.filter() != BooksQuery::Filter::None)
+    {
+        resource += "&filter=";
+        resource += filterName(query.filter());
+    }
+
+    if (auto orderBy = query.orderBy())
+    {
+        resource += "&orderBy=";
+        resource += *orderBy == BooksQuery::OrderBy::Newest ? "newest" : "relevance";
+    }
+
+    if (!query.langRestrict().empty())
+    {
+        resource += "&langRestrict=";
+        UrlEncoder::append(query.langRestrict(), resource);
+    }
+
+    if (auto printType = query.printType())
+    {
+        resource += "&printType=";
+        resource += printTypeName(*printType);
+    }
+
+    if (auto startIndex = query.startIndex())
+    {
+        resource += "&startIndex=";
+        appendNumber(*startIndex, resource);
+    }
+
+    if (auto maxResults = query.maxResults())
+    {
+        resource += "&maxResults=";
+        appendNumber(*maxResults, resource);
+    }
 
-    return buffer;
+    if (!query.options().fields.empty())
+    {
+        resource += "&fields=";
+        UrlEncoder::append(query.options().fields, resource);
+    }
+
+    if (query.options().projection == VolumeProjection::Lite)
+        resource += "&projection=lite";
 }
 
 std::string GoogleBooksInterface::httpGet(const std::string& url)
 {
+    return httpRequest({ "volumes?q=" + url }).body;
+}
+
+HttpResponse GoogleBooksInterface::httpRequest(const HttpRequest& request)
+{
+    lock_guard<recursive_timed_mutex> lock(m_curlMutex);
+
     if (m_curl)
     {
-        auto urlPrefix{ "https://www.googleapis.com/books/v1/volumes?q="s };
-        auto urlAddress = urlPrefix + url + "&key=" + m_apiKey;
+        auto& body = bodyBuffer();
+        body.clear();
 
-        curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, &m_response);
+        m_urlTemplate.expand(request.resource, m_url);
+
+        curl_slist* headers{ nullptr };
+        if (!request.conditional.etag.empty())
+            headers = curl_slist_append(headers, ("If-None-Match: " + request.conditional.etag).c_str());
+        if (!request.conditional.lastModified.empty())
+            headers = curl_slist_append(headers, ("If-Modified-Since: " + request.conditional.lastModified).c_str());
+
+        curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, &body);
         curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, writeCallback);
-        curl_easy_setopt(m_curl, CURLOPT_URL, urlAddress.c_str());
-        auto result = curl_easy_perform(m_curl);
+        curl_easy_setopt(m_curl, CURLOPT_URL, m_url.c_str());
+        curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, headers);
+
+        TimeoutPolicy timeouts;
+        {
+            lock_guard<mutex> settingsLock(m_settingsMutex);
+            timeouts = m_timeouts;
+        }
+
+        const auto started = chrono::steady_clock::now();
+        curl_easy_setopt(m_curl, CURLOPT_CONNECTTIMEOUT_MS, boundedTimeout(timeouts.connectTimeout, request.deadline, started));
+        curl_easy_setopt(m_curl, CURLOPT_TIMEOUT_MS, boundedTimeout(timeouts.transferTimeout, request.deadline, started));
+        curl_easy_setopt(m_curl, CURLOPT_XFERINFODATA, &request);
+
+        auto resolves = 0;
+        curl_easy_setopt(m_curl, CURLOPT_RESOLVER_START_DATA, &resolves);
+
+        GOOGLEBOOKS_PROBE2(request_start, request.resource.data(), request.resource.size());
+
+        auto completed = m_curl;
+        auto result = m_hedging.enabled() ? static_cast<CURLcode>(performHedged(completed)) : curl_easy_perform(m_curl);
+
+        long status{ 0 };
+        curl_easy_getinfo(completed, CURLINFO_RESPONSE_CODE, &status);
+        GOOGLEBOOKS_PROBE2(transfer_complete, static_cast<int>(result), status);
+
+        curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, nullptr);
+        curl_easy_setopt(m_curl, CURLOPT_XFERINFODATA, nullptr);
+        curl_easy_setopt(m_curl, CURLOPT_RESOLVER_START_DATA, nullptr);
+        curl_slist_free_all(headers);
+
+        // The hedge handle is released whichever way this request ends.
+        unique_ptr<CURL, decltype(&curl_easy_cleanup)> hedge{ exchange(m_hedgeCurl, nullptr), curl_easy_cleanup };
+
+        if (result == CURLE_ABORTED_BY_CALLBACK || result == CURLE_OPERATION_TIMEDOUT)
+            throwIfAbandoned(request.deadline, request.cancellation);
+
         if (result != CURLE_OK)
-            throw GoogleBooksInterfaceException{ "Failed to get data from URL" };
+            throw GoogleBooksTransportException{ "Failed to get data from URL", isTransientFailure(result) };
+
+        m_hedging.record(chrono::steady_clock::now() - started);
 
-        return m_response;
+        HttpResponse response;
+        response.status = status;
+        response.body.swap(completed == m_curl ? body : m_hedgeBody);
+        response.validators.etag = responseHeader(completed, "ETag");
+        response.validators.lastModified = responseHeader(completed, "Last-Modified");
+        if (isTransientStatus(response.status))
+            response.retryAfter = retryAfterHeader(completed);
+        response.timing = transferTiming(completed);
+
+        // CURL only starts a resolver for host names missing from its DNS cache.
+        if (!response.timing.connectionReused)
+            m_metrics.recordNameLookup(resolves == 0);
+
+        return response;
     }
 
     throw GoogleBooksInterfaceException{ "CURL Interface not initialized" };
@@ -179,6 +1298,80 @@ std::string GoogleBooksInterface::httpGet(const std::string& url)
     return {};
 }
 
+int GoogleBooksInterface::performHedged(CURL*& completed)
+{
+    if (!m_multi)
+        m_multi = curl_multi_init();
+
+    if (!m_multi)
+        return curl_easy_perform(m_curl);
+
+    const auto hedgeDelay = m_hedging.delay();
+    const auto hedgeAt = chrono::steady_clock::now() + hedgeDelay.value_or(chrono::nanoseconds::zero());
+    auto hedgeDecided = !hedgeDelay;
+    auto active = 1;
+    auto result = CURLE_OK;
+
+    curl_multi_add_handle(m_multi, m_curl);
+    completed = nullptr;
+
+    while (!completed)
+    {
+        int running{ 0 };
+        if (curl_multi_perform(m_multi, &running) != CURLM_OK)
+        {
+            completed = m_curl;
+            result = CURLE_OUT_OF_MEMORY;
+            break;
+        }
+
+        int queued{ 0 };
+        while (auto message = curl_multi_info_read(m_multi, &queued))
+        {
+            if (message->msg != CURLMSG_DONE)
+                continue;
+
+            // A failed transfer only loses the race while the other one may still succeed.
+            if (message->data.result == CURLE_OK || --active == 0)
+            {
+                completed = message->easy_handle;
+                result = message->data.result;
+                break;
+            }
+        }
+
+        if (completed)
+            break;
+
+        const auto now = chrono::steady_clock::now();
+        if (!hedgeDecided && now >= hedgeAt)
+        {
+            hedgeDecided = true;
+
+            if (m_hedging.tryHedge() && (m_hedgeCurl = curl_easy_duphandle(m_curl)) != nullptr)
+            {
+                m_hedgeBody.clear();
+                curl_easy_setopt(m_hedgeCurl, CURLOPT_WRITEDATA, &m_hedgeBody);
+                curl_multi_add_handle(m_multi, m_hedgeCurl);
+                ++active;
+            }
+        }
+
+        auto timeout = chrono::milliseconds{ 1000 };
+        if (!hedgeDecided)
+            timeout = clamp(chrono::duration_cast<chrono::milliseconds>(hedgeAt - now) + chrono::milliseconds{ 1 }, chrono::milliseconds{ 1 }, timeout);
+
+        curl_multi_poll(m_multi, nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+    }
+
+    // Detaching the loser aborts its transfer.
+    curl_multi_remove_handle(m_multi, m_curl);
+    if (m_hedgeCurl)
+        curl_multi_remove_handle(m_multi, m_hedgeCurl);
+
+    return result;
+}
+
 Json::Value GoogleBooksInterface::parseResponse(const std::string& response)
 {
     Json::Value jsonData;
@@ -187,20 +1380,15 @@ Json::Value GoogleBooksInterface::parseResponse(const std::string& response)
 
     istringstream iss(response);
 
-    if (!Json::parseFromStream(builder, iss, &jsonData, &errors))
-        throw GoogleBooksInterfaceException{ "Failed to parse JSON response:\n" + m_response };
-
-    return jsonData;
-}
+    GOOGLEBOOKS_PROBE1(parse_start, response.size());
 
-size_t writeCallback(void* contents, size_t size, size_t nmemb, std::string* userContent)
-{
-    const size_t realsize{ size * nmemb };
+    if (!Json::parseFromStream(builder, iss, &jsonData, &errors))
+    {
+        GOOGLEBOOKS_PROBE2(parse_end, response.size(), 0);
+        throw GoogleBooksInterfaceException{ "Failed to parse JSON response:\n" + response };
+    }
 
-    if (!userContent)
-        return 0;
+    GOOGLEBOOKS_PROBE2(parse_end, response.size(), 1);
 
-    userContent->append((char*)contents, realsize);
-    
-    return realsize;
+    return jsonData;
 }
@@ -1,18 +1,32 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 
+#include "BackgroundRefresher.h"
+#include "BooksQuery.h"
+#include "CircuitBreaker.h"
+#include "ClientMetrics.h"
+#include "ConcurrencyLimiter.h"
+#include "DllApi.h"
+#include "FlightRecorder.h"
+#include "HedgeController.h"
+#include "HttpTypes.h"
+#include "QueryCache.h"
+#include "RateLimiter.h"
+#include "RetryPolicy.h"
+#include "SearchOptions.h"
+#include "SingleFlight.h"
 #include "Singleton.h"
-
-#ifdef GOOGLEBOOKSAPI_EXPORTS
-#define DLL_API __declspec(dllexport)
-#else
-#define DLL_API __declspec(dllimport)
-#endif // IRESTCLIENT_EXPORTS
-
-#pragma warning(disable : 4251)
+#include "Tracing.h"
+#include "UrlTemplate.h"
+#include "VolumeCache.h"
 
 using CURL = void;
+using CURLM = void;
+using CURLSH = void;
 
 namespace Json
 {
@@ -42,12 +56,98 @@ private:
     std::string m_what; ///< The exception message.
 };
 
+/**
+ * @class GoogleBooksTransportException
+ * @brief Failure of a transfer before any HTTP response was received.
+ */
+class GoogleBooksTransportException : public GoogleBooksInterfaceException
+{
+public:
+    /**
+     * @brief Constructs a GoogleBooksTransportException.
+     * @param message The exception message.
+     * @param transient True when retrying may succeed, e.g. after a connection reset or a timeout.
+     */
+    GoogleBooksTransportException(const std::string& message, bool transient) : GoogleBooksInterfaceException{ message }, m_transient{ transient } {}
+
+    /**
+     * @brief Tells whether retrying may succeed.
+     * @return True for connection resets, timeouts and similar failures.
+     */
+    bool transient() const noexcept { return m_transient; }
+
+private:
+    bool m_transient; ///< Whether retrying may succeed.
+};
+
+/**
+ * @class GoogleBooksCancelledException
+ * @brief Abandonment of a call whose deadline passed or whose cancellation token was cancelled.
+ */
+class GoogleBooksCancelledException : public GoogleBooksInterfaceException
+{
+public:
+    /**
+     * @brief Constructs a GoogleBooksCancelledException.
+     * @param message The exception message.
+     * @param deadlineExceeded True when the deadline passed, false when the call was cancelled.
+     */
+    GoogleBooksCancelledException(const std::string& message, bool deadlineExceeded) : GoogleBooksInterfaceException{ message }, m_deadlineExceeded{ deadlineExceeded } {}
+
+    /**
+     * @brief Tells why the call was abandoned.
+     * @return True when the deadline passed, false when the call was cancelled.
+     */
+    bool deadlineExceeded() const noexcept { return m_deadlineExceeded; }
+
+private:
+    bool m_deadlineExceeded; ///< Whether the deadline passed rather than the token being cancelled.
+};
+
+/**
+ * @class GoogleBooksCircuitOpenException
+ * @brief Refusal of a request while the circuit breaker is open and no cached response can stand in.
+ */
+class GoogleBooksCircuitOpenException : public GoogleBooksInterfaceException
+{
+public:
+    using GoogleBooksInterfaceException::GoogleBooksInterfaceException;
+};
+
 /**
  * @class GoogleBooksInterface
  * @brief Interface for interacting with the Google Books API.
  *
- * This class provides methods to search for books by subject, title, author, and ISBN.
+ * This class provides methods to search for books by subject, title, author, and ISBN,
+ * or by any combination of qualifiers through a BooksQuery.
  * It also handles HTTP requests and responses, and parses JSON data.
+ *
+ * An instance may be shared between threads. Identical searches issued concurrently
+ * are collapsed into a single transfer whose result is handed to every caller.
+ * Cached responses past their TTL keep being served during the stale grace period
+ * while a background thread re-runs the query. Refreshes of cached responses are
+ * conditional requests, so an unchanged page costs a 304 and no parsing.
+ * Volumes from every response are also cached by id, and ISBN lookups are answered
+ * from that cache when the book was already seen in any search.
+ * Every transfer takes a token from RateLimiter::shared(), which keeps all the
+ * instances of the process under the API quota, and a slot of the adaptive window
+ * of ConcurrencyLimiter::shared(), which backs off when the API signals overload.
+ * Connection resets, timeouts, 429 and 5xx responses are retried with jittered
+ * exponential backoff, honoring Retry-After, within a process-wide RetryBudget.
+ * Optionally, requests slower than a percentile of recent latency are hedged.
+ * Every transfer is bounded by the timeouts of the interface, and searches taking
+ * SearchOptions are also bounded by its deadline and cancellation token.
+ * A circuit breaker stops calling an API that keeps failing: while it is open,
+ * requests fail at once or are answered from the cache however old.
+ * The latency of every search method, of transfers and of parsing is recorded in
+ * lock-free histograms, see latency(), and every metric of the interface can be
+ * rendered for Prometheus with prometheusMetrics(). A Tracer set with setTracer()
+ * receives a span per call, with children for queueing, transfers and parsing.
+ * The last few thousand transfers are kept in a lock-free flight recorder, see flightRecorder().
+ * The CURL instance and its hedges share their connection pool, DNS cache and TLS
+ * sessions, whose health connectionStats() reports.
+ * Once warmed up, a request allocates nothing until its response is parsed: the
+ * resource, URL and response body are built in buffers reused by each thread.
  */
 class DLL_API GoogleBooksInterface
 {
@@ -109,6 +209,8 @@ public:
 
     /**
      * @brief Retrieves all books by ISBN.
+     *
+     * The first page may come from the volume cache, see the overload taking SearchOptions.
      * @param ISBN The ISBN of the book to search for.
      * @param startIndex The index of the first result to return.
      * @param maxResults The maximum number of results to return.
@@ -116,12 +218,202 @@ public:
      */
     virtual Json::Value getAllBooksByIsbn(const std::string& ISBN, int startIndex = 0, int maxResults = 40);
 
+    /**
+     * @brief Retrieves all books by a search term, with per-call options.
+     * @param term The search term.
+     * @param options The fields selector and projection to request.
+     * @param startIndex The index of the first result to return.
+     * @param maxResults The maximum number of results to return.
+     * @return A JSON value containing the search results.
+     */
+    Json::Value getAllBooksByTerm(const std::string& term, const SearchOptions& options, int startIndex = 0, int maxResults = 40);
+
+    /**
+     * @brief Retrieves all books by subject, with per-call options.
+     * @param term The search term.
+     * @param subject The subject to search for.
+     * @param options The fields selector and projection to request.
+     * @param startIndex The index of the first result to return.
+     * @param maxResults The maximum number of results to return.
+     * @return A JSON value containing the search results.
+     */
+    Json::Value getAllBooksBySubject(const std::string& term, const std::string& subject, const SearchOptions& options, int startIndex = 0, int maxResults = 40);
+
+    /**
+     * @brief Retrieves all books by title, with per-call options.
+     * @param term The search term.
+     * @param bookTitle The title of the book to search for.
+     * @param options The fields selector and projection to request.
+     * @param startIndex The index of the first result to return.
+     * @param maxResults The maximum number of results to return.
+     * @return A JSON value containing the search results.
+     */
+    Json::Value getAllBooksByTitle(const std::string& term, const std::string& bookTitle, const SearchOptions& options, int startIndex = 0, int maxResults = 40);
+
+    /**
+     * @brief Retrieves all books by author, with per-call options.
+     * @param term The search term.
+     * @param author The author of the book to search for.
+     * @param options The fields selector and projection to request.
+     * @param startIndex The index of the first result to return.
+     * @param maxResults The maximum number of results to return.
+     * @return A JSON value containing the search results.
+     */
+    Json::Value getAllBooksByAuthor(const std::string& term, const std::string& author, const SearchOptions& options, int startIndex = 0, int maxResults = 40);
+
+    /**
+     * @brief Retrieves all books by ISBN, with per-call options.
+     *
+     * A volume already in the volume cache answers the first page, unless a fields selector
+     * or the lite projection is requested; the deadline and cancellation are checked first.
+     * That answer is not what the network would return: it holds the cached volume alone,
+     * with a totalItems of 1 even when other volumes share the ISBN, and its item has no
+     * searchInfo since the cache keeps volumes without their query-specific members.
+     * @param ISBN The ISBN of the book to search for.
+     * @param options The fields selector, projection, deadline and cancellation of the call.
+     * @param startIndex The index of the first result to return.
+     * @param maxResults The maximum number of results to return.
+     * @return A JSON value containing the search results.
+     */
+    Json::Value getAllBooksByIsbn(const std::string& ISBN, const SearchOptions& options, int startIndex = 0, int maxResults = 40);
+
+    /**
+     * @brief Retrieves the books matching every qualifier and parameter of a query, in one request.
+     * @param query The combined search.
+     * @return A JSON value containing the search results.
+     * @throws GoogleBooksInterfaceException when the query has neither a term nor a qualifier.
+     */
+    virtual Json::Value search(const BooksQuery& query);
+
+    /**
+     * @brief Retrieves a single volume by id from the volumes/{id} endpoint.
+     *
+     * A volume already fetched by id is returned from the volume cache without a request;
+     * one only seen in search results answers lite lookups alone, since search items
+     * leave some details of the volume out. Lite responses are cached per query only,
+     * so that they never stand in for the full volume.
+     * @param volumeId The volume id, as found in the "id" member of search results.
+     * @param projection The representation to request.
+     * @return A JSON value containing the volume, or the error returned by the API.
+     */
+    virtual Json::Value getVolumeById(const std::string& volumeId, VolumeProjection projection = VolumeProjection::Full);
+
     /**
      * @brief Sets the API key for accessing the Google Books API.
      * @param apiKey The API key to set.
      */
     void setApiKey(const std::string& apiKey);
 
+    /**
+     * @brief Sets how transient failures of this interface are retried.
+     *
+     * Retries are also bounded by RetryBudget::shared(), whatever the policy allows.
+     * @param policy The number of attempts and the backoff.
+     */
+    void setRetryPolicy(const RetryPolicy& policy);
+
+    /**
+     * @brief Sets when slow requests of this interface are hedged.
+     *
+     * A request still running after the policy percentile of recent latencies is
+     * duplicated on a second connection; the first response wins and the other
+     * transfer is aborted.
+     * @param policy The percentile and the cap on hedged traffic.
+     */
+    void setHedgePolicy(const HedgePolicy& policy);
+
+    /**
+     * @brief Sets when the circuit breaker of this interface opens and how it recovers.
+     *
+     * Transport failures, 429 and 5xx responses count as failures. While the circuit is
+     * open, requests are not sent; they are answered from the cache, however old, or
+     * fail with a GoogleBooksCircuitOpenException.
+     * @param policy The failure rate threshold, open duration, probes and fallback.
+     */
+    void setCircuitBreakerPolicy(const CircuitPolicy& policy);
+
+    /**
+     * @brief Sets the connect and transfer timeouts of every transfer of this interface.
+     *
+     * A call with a deadline is also aborted when the deadline comes first.
+     * @param policy The timeouts.
+     */
+    void setTimeoutPolicy(const TimeoutPolicy& policy);
+
+    /**
+     * @brief Sets the tracer receiving the spans of this interface's calls.
+     *
+     * Without a tracer, calls record no span and allocate nothing for tracing.
+     * @param tracer The tracer, null to stop tracing.
+     */
+    void setTracer(std::shared_ptr<Tracer> tracer);
+
+    /**
+     * @brief Points every request at another API root, such as a mirror or a local mock server.
+     *
+     * Cached responses came from the previous endpoint and are discarded.
+     * @param endpoint An absolute URL, e.g. "http://127.0.0.1:8080/books/v1/".
+     * @throw GoogleBooksInterfaceException When the endpoint is not a valid absolute URL.
+     */
+    void setEndpoint(const std::string& endpoint);
+
+    /**
+     * @brief Sets how long search responses are cached.
+     *
+     * Responses with volumes use the positive TTL, zero-result and not-found responses
+     * use the negative TTL. Error responses are never cached. Expired entries are served
+     * for the stale grace period while they are refreshed in the background. Volumes
+     * cached by id use the positive TTL.
+     * @param policy The lifetime and size settings.
+     */
+    void setCachePolicy(const CachePolicy& policy);
+
+    /**
+     * @brief Discards every cached search response and volume.
+     */
+    void clearCache();
+
+    /**
+     * @brief Retrieves the latency histogram of an operation of this interface.
+     *
+     * Search methods record their whole duration, cache hits included. Transfer records
+     * the network time of each fetch and Parse the parsing of each response, so that the
+     * two can be told apart. Drain the histograms periodically for per-interval percentiles.
+     * @param operation The operation.
+     * @return The histogram, which may be read, drained or reset concurrently with the calls it records.
+     */
+    LatencyHistogram& latency(LatencyOperation operation);
+
+    /**
+     * @brief Renders the metrics of this interface in the Prometheus text exposition format.
+     *
+     * Covers calls by method and outcome, latency percentiles, cache hits and misses,
+     * transfers in flight, bytes received, connection reuse and retries, along with the
+     * waits of the process-wide rate limiter and its concurrency window.
+     * @return The metrics, ready to be served on a /metrics endpoint.
+     */
+    std::string prometheusMetrics() const;
+
+    /**
+     * @brief Retrieves the health of the connection pool of this interface.
+     *
+     * Tells whether keep-alive works: how many transfers opened a connection or reused
+     * one, how many TLS handshakes and DNS lookups new connections cost, and how many
+     * open connections are carrying a transfer or waiting in the pool.
+     * @return The connection counters and the open connections by state.
+     */
+    ConnectionStats connectionStats() const;
+
+    /**
+     * @brief Retrieves the recorder of the most recent transfers of this interface.
+     *
+     * Every transfer, retries and failures included, is recorded with its timings,
+     * status, size and error, and the hash of its resource. Snapshot or dump it when
+     * investigating an incident, or from a crash handler.
+     * @return The recorder, which may be read concurrently with the transfers it records.
+     */
+    const FlightRecorder& flightRecorder() const;
+
     /**
      * @brief Initializes the interface by setting up the CURL instance.
      */
@@ -132,14 +424,28 @@ public:
 
 protected:
     std::string m_apiKey; ///< The API key for accessing the Google Books API.
-    std::string m_response; ///< The response from the Google Books API.
 
     /**
      * @brief Performs an HTTP GET request.
-     * @param url The URL to send the request to.
+     *
+     * @deprecated Searches no longer go through this method, so it is not virtual anymore:
+     * an override would be silently bypassed. Override httpRequest() to intercept transfers.
+     * @param url The q parameter of a search on the volumes endpoint.
      * @return The response as a string.
      */
-    virtual std::string httpGet(const std::string& url);
+    std::string httpGet(const std::string& url);
+
+    /**
+     * @brief Performs an HTTP GET request on the volumes endpoint.
+     *
+     * Validators set on the request are sent as If-None-Match and If-Modified-Since,
+     * and the ETag and Last-Modified headers of the response are captured.
+     * Searches call it with the transport of this instance held, so transfers of one
+     * instance never overlap, overrides included.
+     * @param request The resource and optional validators.
+     * @return The status, body and validators of the response.
+     */
+    virtual HttpResponse httpRequest(const HttpRequest& request);
 
     /**
      * @brief Parses the JSON response.
@@ -149,13 +455,124 @@ protected:
     virtual Json::Value parseResponse(const std::string& response);
 
 private:
+    /**
+     * @struct Fetched
+     * @brief Outcome of a fetch, shared with the callers that joined it.
+     */
+    struct Fetched
+    {
+        std::shared_ptr<const Json::Value> books; ///< The parsed response, null when the transport returned no data.
+        TransferTiming timing{}; ///< Timing of the transfer, empty when the response came from the cache.
+    };
+
     CURL* m_curl; ///< The CURL instance for making HTTP requests.
+    std::recursive_timed_mutex m_curlMutex; ///< Serializes transfers on the CURL instance and the URL buffer; transfer() holds it around httpRequest(), which takes it again.
+    UrlTemplate m_urlTemplate; ///< Endpoint and encoded key every request URL is built from, guarded by m_curlMutex.
+    std::string m_url; ///< URL of the transfer in progress, reused so that its capacity survives between requests.
+    CURLM* m_multi; ///< Multi handle racing a hedge against a slow transfer, created on first use.
+    CURLSH* m_share; ///< Connection pool, DNS cache and TLS sessions shared by the CURL instance and its hedges.
+    CURL* m_hedgeCurl; ///< Duplicate of the CURL instance sent as a hedge, null outside a hedged race.
+    std::string m_hedgeBody; ///< Response body of the hedge.
+    HedgeController m_hedging; ///< Recent latencies and hedge budget.
+    CircuitBreaker m_breaker; ///< Refuses transfers while the API keeps failing.
+    QueryCache m_queryCache; ///< Parsed responses keyed by query URL.
+    VolumeCache m_volumeCache; ///< Volumes seen in any response, keyed by volume id.
+    SingleFlight<std::string, Fetched> m_inFlight; ///< Fetches in flight keyed by resource.
+    BackgroundRefresher m_refresher; ///< Re-runs queries whose cached response went stale.
+    ClientMetrics m_metrics; ///< Counters and latency histograms.
+    FlightRecorder m_flightRecorder; ///< The most recent transfers.
+    std::mutex m_settingsMutex; ///< Guards the retry and timeout policies and the tracer.
+    RetryPolicy m_retryPolicy; ///< How transient failures are retried.
+    TimeoutPolicy m_timeouts; ///< Bounds of every transfer.
+    std::shared_ptr<Tracer> m_tracer; ///< Receives the spans of the calls, null when not tracing.
+    std::atomic<bool> m_tracing{ false }; ///< Whether a tracer is set, read without taking the lock.
 
     /**
      * @brief Initializes the CURL instance.
      */
     void initCurl();
 
+    /**
+     * @brief Performs the transfer configured on the CURL instance, racing a hedge against it when it runs late.
+     * @param completed Receives the handle whose transfer completed first.
+     * @return The CURLcode of that transfer.
+     */
+    int performHedged(CURL*& completed);
+
+    /**
+     * @brief Retrieves the tracer of new calls.
+     * @return The tracer, null when not tracing.
+     */
+    std::shared_ptr<Tracer> tracer();
+
+    /**
+     * @brief Runs a search method, recording its latency, outcome and span.
+     * @param operation The method.
+     * @param call The callable performing the search.
+     * @return The result of the search.
+     */
+    template <typename Call>
+    Json::Value measure(LatencyOperation operation, Call&& call);
+
+    /**
+     * @brief Runs a query without recording its latency.
+     * @param query The query.
+     * @return A JSON value containing the search results.
+     */
+    Json::Value runQuery(const BooksQuery& query);
+
+    /**
+     * @brief Serves a resource from the cache or fetches and caches it.
+     *
+     * Concurrent callers with the same resource share a single fetch. A caller whose
+     * shared fetch was abandoned by another caller's deadline or cancellation fetches again.
+     * @param resource The path and query relative to the API root.
+     * @param options The deadline, cancellation token and timing output of the call.
+     * @return A JSON value containing the search results or the volume.
+     * @throw GoogleBooksCancelledException When the deadline passes or the call is cancelled first.
+     */
+    Json::Value fetchBooks(const std::string& resource, const SearchOptions& options = {});
+
+    /**
+     * @brief Fetches a resource through the transport and caches the parsed response.
+     *
+     * When a cached copy carries validators the request is made conditional, and a
+     * 304 Not Modified reuses the cached parsed response.
+     * @param resource The path and query relative to the API root.
+     * @param options The deadline and cancellation token of the call.
+     * @return The parsed response and the timing of its transfer.
+     */
+    Fetched fetchAndStore(const std::string& resource, const SearchOptions& options = {});
+
+    /**
+     * @brief Sends a request, retrying transient failures with backoff until its deadline.
+     * @param request The resource and optional validators.
+     * @return The last response received; a transient status means the retries were exhausted.
+     */
+    HttpResponse transferWithRetries(const HttpRequest& request);
+
+    /**
+     * @brief Sends a request once, through the circuit breaker and within the process-wide rate limit and concurrency window.
+     * @param request The resource and optional validators.
+     * @return The response.
+     * @throw GoogleBooksCircuitOpenException When the circuit breaker refuses the request.
+     */
+    HttpResponse transfer(const HttpRequest& request);
+
+    /**
+     * @brief Splits a response into its envelope and its volumes.
+     * @param books The parsed search response or volume.
+     * @param intern True to intern the volumes in the volume cache, false for partial representations.
+     * @return The page to store in the query cache.
+     */
+    std::shared_ptr<const CachedPage> splitPage(const Json::Value& books, bool intern);
+
+    /**
+     * @brief Re-runs a resource whose cached response went stale, joining a fetch already in flight.
+     * @param resource The path and query relative to the API root.
+     */
+    void refreshQuery(const std::string& resource);
+
     /**
      * @brief Replaces spaces in a string with a specified character.
      * @param str The string to modify.
@@ -165,11 +582,11 @@ private:
     std::string replaceSpaces(std::string str, const char sign = '+');
 
     /**
-     * @brief Escapes special characters in a string for use in a URL.
-     * @param data The string to escape.
-     * @return The escaped string.
+     * @brief Builds the volumes search resource of a query.
+     * @param query The combined search.
+     * @param resource Receives the path and query relative to the API root, e.g. "volumes?q=...&maxResults=40".
      */
-    std::string escapeString(const std::string& data);
+    void buildResource(const BooksQuery& query, std::string& resource);
 };
 
 /**
@@ -183,13 +600,3 @@ using GoogleBooksInterfaceSingleton = Singleton<GoogleBooksInterface>;
  * @brief Singleton instance of GoogleBooksInterface with an API key.
  */
 using GoogleBooksInterfaceWithKeySingleton = Singleton<GoogleBooksInterface, const std::string&>;
-
-/**
- * @brief Callback function for writing data received from CURL.
- * @param contents The data received.
- * @param size The size of each data element.
- * @param nmemb The number of data elements.
- * @param userContent The user content to write to.
- * @return The number of bytes written.
- */
-static size_t writeCallback(void* contents, size_t size, size_t nmemb, std::string* userContent);
@@ -0,0 +1,66 @@
+#include "pch.h"
+
+#include <algorithm>
+
+#include "HedgeController.h"
+
+using namespace std;
+
+namespace
+{
+    constexpr double maxSavedHedges{ 2.0 }; ///< Hedges an idle controller may send back to back.
+}
+
+HedgeController::HedgeController(const HedgePolicy& policy) : m_policy{ policy }, m_budget{ policy.maxHedgeRatio, maxSavedHedges }
+{
+}
+
+void HedgeController::setPolicy(const HedgePolicy& policy)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_policy = policy;
+    m_budget.configure(policy.maxHedgeRatio, maxSavedHedges);
+}
+
+HedgePolicy HedgeController::policy() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_policy;
+}
+
+bool HedgeController::enabled() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_policy.enabled;
+}
+
+optional<chrono::nanoseconds> HedgeController::delay() const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    const auto count = min(m_recorded, windowSize);
+    if (!m_policy.enabled || count == 0 || count < m_policy.minSamples)
+        return nullopt;
+
+    auto latencies = m_latencies;
+    const auto last = latencies.begin() + count;
+    const auto rank = latencies.begin() + min(count - 1, static_cast<size_t>(clamp(m_policy.percentile, 0.0, 1.0) * count));
+    nth_element(latencies.begin(), rank, last);
+
+    return *rank;
+}
+
+void HedgeController::record(chrono::nanoseconds latency)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_latencies[m_recorded++ % windowSize] = latency;
+    }
+
+    m_budget.recordRequest();
+}
+
+bool HedgeController::tryHedge()
+{
+    return m_budget.tryWithdraw();
+}
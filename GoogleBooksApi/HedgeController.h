@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+#include "DllApi.h"
+#include "RetryPolicy.h"
+
+/**
+ * @struct HedgePolicy
+ * @brief When a duplicate of a slow request is sent.
+ */
+struct HedgePolicy
+{
+    bool enabled{ false }; ///< Whether slow requests are hedged at all.
+    double percentile{ 0.95 }; ///< Fraction of recent requests that completed before a hedge is sent, e.g. 0.95 for p95.
+    double maxHedgeRatio{ 0.05 }; ///< Hedges allowed per request, so that hedging adds at most this fraction to the traffic.
+    size_t minSamples{ 20 }; ///< Latencies to observe before the percentile is trusted.
+};
+
+/**
+ * @class HedgeController
+ * @brief Decides when a request is hedged, from the latencies of recent requests.
+ *
+ * The delay before a hedge is the policy percentile of the last latencies recorded.
+ * Hedges draw from a ratio budget filled by every request, so a slow upstream cannot
+ * double the traffic.
+ */
+class DLL_API HedgeController
+{
+public:
+    /**
+     * @brief Constructs a controller.
+     * @param policy The percentile and budget; disabled by default.
+     */
+    explicit HedgeController(const HedgePolicy& policy = {});
+
+    HedgeController(const HedgeController&) = delete;
+    HedgeController& operator=(const HedgeController&) = delete;
+
+    /**
+     * @brief Replaces the policy, keeping the recorded latencies.
+     * @param policy The new percentile and budget.
+     */
+    void setPolicy(const HedgePolicy& policy);
+
+    /**
+     * @brief Retrieves the current policy.
+     * @return A copy of the policy.
+     */
+    HedgePolicy policy() const;
+
+    /**
+     * @brief Tells whether requests should be sent so that they can be hedged.
+     * @return True when hedging is enabled.
+     */
+    bool enabled() const;
+
+    /**
+     * @brief Computes how long a request may run before it is hedged.
+     * @return The delay, or nothing while hedging is disabled or too few latencies were recorded.
+     */
+    std::optional<std::chrono::nanoseconds> delay() const;
+
+    /**
+     * @brief Records the latency of a completed request and deposits its share of hedges.
+     * @param latency The time from sending the request to receiving the response.
+     */
+    void record(std::chrono::nanoseconds latency);
+
+    /**
+     * @brief Takes a hedge from the budget.
+     * @return True if the hedge may be sent.
+     */
+    bool tryHedge();
+
+private:
+    static constexpr size_t windowSize{ 128 }; ///< Number of recent latencies kept.
+
+    mutable std::mutex m_mutex; ///< Guards the policy and the latencies.
+    HedgePolicy m_policy; ///< The percentile and budget.
+    std::array<std::chrono::nanoseconds, windowSize> m_latencies{}; ///< Ring of recent latencies.
+    size_t m_recorded{ 0 }; ///< Latencies recorded since construction.
+    RetryBudget m_budget; ///< Ratio budget of hedges, filled by every recorded request.
+};
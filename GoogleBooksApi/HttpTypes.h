@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "Cancellation.h"
+
+/**
+ * @struct HttpValidators
+ * @brief Cache validators of a response, echoed back to make a request conditional.
+ */
+struct HttpValidators
+{
+    std::string etag{}; ///< Value of the ETag header, sent back as If-None-Match.
+    std::string lastModified{}; ///< Value of the Last-Modified header, sent back as If-Modified-Since.
+
+    /**
+     * @brief Tells whether the response carried no validator at all.
+     * @return True when both validators are empty.
+     */
+    bool empty() const { return etag.empty() && lastModified.empty(); }
+};
+
+/**
+ * @struct HttpRequest
+ * @brief A request to the Google Books API.
+ */
+struct HttpRequest
+{
+    std::string_view resource; ///< The path and query relative to the API root, e.g. "volumes?q=isbn:9780553804577". Only valid during the call.
+    HttpValidators conditional{}; ///< Validators of a cached copy; when set, the server may answer 304 Not Modified.
+    std::chrono::steady_clock::time_point deadline{ std::chrono::steady_clock::time_point::max() }; ///< Time at which the transfer is aborted.
+    CancellationToken cancellation{}; ///< Token whose cancellation aborts the transfer.
+};
+
+/**
+ * @struct TimeoutPolicy
+ * @brief Bounds of a single transfer, whatever the deadline of the call.
+ *
+ * A zero timeout leaves that phase unbounded, apart from the deadline of the call.
+ */
+struct TimeoutPolicy
+{
+    std::chrono::milliseconds connectTimeout{ 10000 }; ///< Longest time to establish the connection, TLS included.
+    std::chrono::milliseconds transferTimeout{ 30000 }; ///< Longest time for the whole transfer, connection included.
+};
+
+/**
+ * @struct TransferTiming
+ * @brief Where the time of a transfer went, as reported by CURL.
+ *
+ * Phases are measured from the start of the transfer and are cumulative: the TLS
+ * handshake took appConnect - connect, and the server took startTransfer - appConnect
+ * (or - connect over plain HTTP). Phases skipped on a reused connection are zero.
+ */
+struct TransferTiming
+{
+    std::chrono::microseconds nameLookup{ 0 }; ///< Until the host name was resolved.
+    std::chrono::microseconds connect{ 0 }; ///< Until the TCP connection was established.
+    std::chrono::microseconds appConnect{ 0 }; ///< Until the TLS handshake completed, zero over plain HTTP.
+    std::chrono::microseconds startTransfer{ 0 }; ///< Until the first byte of the response was received.
+    std::chrono::microseconds total{ 0 }; ///< Until the last byte of the response was received.
+    std::uint64_t bytesDownloaded{ 0 }; ///< Size of the response body as received, before decompression.
+    bool connectionReused{ false }; ///< Whether an idle connection was reused instead of opening a new one.
+    bool transferred{ false }; ///< Whether a transfer took place at all; false for responses served from the cache.
+};
+
+/**
+ * @struct HttpResponse
+ * @brief Outcome of a completed transfer.
+ */
+struct HttpResponse
+{
+    long status{ 0 }; ///< The HTTP status code, 0 when the transport did not report one.
+    std::string body; ///< The response body, empty on 304 Not Modified.
+    HttpValidators validators{}; ///< Validators sent by the server for this representation.
+    std::chrono::milliseconds retryAfter{ 0 }; ///< Wait requested by a Retry-After header, zero when absent.
+    TransferTiming timing{}; ///< Where the time of the transfer went.
+
+    /**
+     * @brief Tells whether the server confirmed that the cached copy is still current.
+     * @return True on 304 Not Modified.
+     */
+    bool notModified() const { return status == 304; }
+};
@@ -0,0 +1,178 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "LatencyHistogram.h"
+
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Finds the position of the highest set bit.
+     * @param value A non-zero value.
+     * @return The position, 0 for the lowest bit.
+     */
+    int highestBit(uint64_t value)
+    {
+        auto bit = 0;
+        while (value >>= 1)
+            ++bit;
+
+        return bit;
+    }
+}
+
+const char* latencyOperationName(LatencyOperation operation)
+{
+    switch (operation)
+    {
+    case LatencyOperation::Term:
+        return "term";
+    case LatencyOperation::Subject:
+        return "subject";
+    case LatencyOperation::Title:
+        return "title";
+    case LatencyOperation::Author:
+        return "author";
+    case LatencyOperation::Isbn:
+        return "isbn";
+    case LatencyOperation::Query:
+        return "query";
+    case LatencyOperation::Volume:
+        return "volume";
+    case LatencyOperation::Transfer:
+        return "transfer";
+    case LatencyOperation::Parse:
+        return "parse";
+    default:
+        return "unknown";
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(chrono::nanoseconds latency)
+{
+    const auto nanoseconds = static_cast<uint64_t>(max<int64_t>(latency.count(), 0));
+
+    m_buckets[bucketOf(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    m_sum.fetch_add(nanoseconds, memory_order_relaxed);
+    m_totalCount.fetch_add(1, memory_order_relaxed);
+    m_totalSum.fetch_add(nanoseconds, memory_order_relaxed);
+
+    auto highest = m_max.load(memory_order_relaxed);
+    while (nanoseconds > highest && !m_max.compare_exchange_weak(highest, nanoseconds, memory_order_relaxed))
+    {
+    }
+}
+
+chrono::nanoseconds LatencyHistogram::percentile(double percentile) const
+{
+    Counts counts;
+    uint64_t total{ 0 };
+
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+        total += counts[bucket] = m_buckets[bucket].load(memory_order_relaxed);
+
+    return chrono::nanoseconds{ percentileOf(counts, total, m_max.load(memory_order_relaxed), percentile) };
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+    Counts counts;
+
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+        counts[bucket] = m_buckets[bucket].load(memory_order_relaxed);
+
+    return summarize(counts, m_sum.load(memory_order_relaxed), m_max.load(memory_order_relaxed));
+}
+
+LatencySummary LatencyHistogram::drain()
+{
+    Counts counts;
+
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+        counts[bucket] = m_buckets[bucket].exchange(0, memory_order_relaxed);
+
+    return summarize(counts, m_sum.exchange(0, memory_order_relaxed), m_max.exchange(0, memory_order_relaxed));
+}
+
+LatencyTotals LatencyHistogram::totals() const
+{
+    return { m_totalCount.load(memory_order_relaxed), chrono::nanoseconds{ m_totalSum.load(memory_order_relaxed) } };
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, memory_order_relaxed);
+
+    m_sum.store(0, memory_order_relaxed);
+    m_max.store(0, memory_order_relaxed);
+    m_totalCount.store(0, memory_order_relaxed);
+    m_totalSum.store(0, memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t nanoseconds)
+{
+    if (nanoseconds < linearLimit)
+        return static_cast<size_t>(nanoseconds);
+
+    const auto exponent = min(highestBit(nanoseconds), maxExponent);
+    const auto shift = exponent - subBucketBits;
+    const auto subBucket = min<uint64_t>(nanoseconds >> shift, (uint64_t{ 2 } << subBucketBits) - 1) - (uint64_t{ 1 } << subBucketBits);
+
+    return static_cast<size_t>(linearLimit + (static_cast<uint64_t>(exponent) - subBucketBits - 1) * (uint64_t{ 1 } << subBucketBits) + subBucket);
+}
+
+uint64_t LatencyHistogram::highestIn(size_t bucket)
+{
+    if (bucket < linearLimit)
+        return bucket;
+
+    const auto offset = bucket - linearLimit;
+    const auto exponent = static_cast<int>(offset >> subBucketBits) + subBucketBits + 1;
+    const auto top = (uint64_t{ 1 } << subBucketBits) + (offset & ((size_t{ 1 } << subBucketBits) - 1));
+
+    return ((top + 1) << (exponent - subBucketBits)) - 1;
+}
+
+uint64_t LatencyHistogram::percentileOf(const Counts& counts, uint64_t total, uint64_t max, double percentile)
+{
+    if (total == 0)
+        return 0;
+
+    const auto rank = std::max<uint64_t>(static_cast<uint64_t>(ceil(clamp(percentile, 0.0, 1.0) * total)), 1);
+    uint64_t seen{ 0 };
+
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+    {
+        seen += counts[bucket];
+        if (seen >= rank)
+            return min(highestIn(bucket), max);
+    }
+
+    return max;
+}
+
+LatencySummary LatencyHistogram::summarize(const Counts& counts, uint64_t sum, uint64_t max)
+{
+    LatencySummary summary;
+
+    for (auto count : counts)
+        summary.count += count;
+
+    summary.sum = chrono::nanoseconds{ sum };
+    summary.p50 = chrono::nanoseconds{ percentileOf(counts, summary.count, max, 0.5) };
+    summary.p90 = chrono::nanoseconds{ percentileOf(counts, summary.count, max, 0.9) };
+    summary.p99 = chrono::nanoseconds{ percentileOf(counts, summary.count, max, 0.99) };
+    summary.p999 = chrono::nanoseconds{ percentileOf(counts, summary.count, max, 0.999) };
+    summary.max = chrono::nanoseconds{ max };
+
+    return summary;
+}
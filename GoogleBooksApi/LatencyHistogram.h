@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "DllApi.h"
+
+/**
+ * @enum LatencyOperation
+ * @brief Operations whose latency GoogleBooksInterface records.
+ */
+enum class LatencyOperation
+{
+    Term, ///< getAllBooksByTerm, whether answered from the cache or not.
+    Subject, ///< getAllBooksBySubject.
+    Title, ///< getAllBooksByTitle.
+    Author, ///< getAllBooksByAuthor.
+    Isbn, ///< getAllBooksByIsbn.
+    Query, ///< search with a BooksQuery.
+    Volume, ///< getVolumeById.
+    Transfer, ///< Network time of one transfer, once it holds the transport; each retry is a sample of its own.
+    Parse, ///< Parsing of a response body.
+    Count ///< Number of operations, not an operation.
+};
+
+/**
+ * @brief Retrieves the name of an operation, e.g. for metric labels.
+ * @param operation The operation.
+ * @return The lowercase name, e.g. "term" or "parse".
+ */
+DLL_API const char* latencyOperationName(LatencyOperation operation);
+
+/**
+ * @struct LatencySummary
+ * @brief Percentiles of the latencies recorded by a LatencyHistogram.
+ *
+ * Percentiles are the highest latency of their bucket, so they overstate the exact
+ * value by at most 1/32 of it; the maximum is exact.
+ */
+struct LatencySummary
+{
+    std::uint64_t count{ 0 }; ///< Number of latencies recorded.
+    std::chrono::nanoseconds sum{ 0 }; ///< Sum of the latencies recorded.
+    std::chrono::nanoseconds p50{ 0 }; ///< Median.
+    std::chrono::nanoseconds p90{ 0 }; ///< 90th percentile.
+    std::chrono::nanoseconds p99{ 0 }; ///< 99th percentile.
+    std::chrono::nanoseconds p999{ 0 }; ///< 99.9th percentile.
+    std::chrono::nanoseconds max{ 0 }; ///< Highest latency recorded.
+};
+
+/**
+ * @struct LatencyTotals
+ * @brief Count and sum of every latency a LatencyHistogram recorded since its construction or reset.
+ *
+ * Unlike the buckets, drain() leaves them alone, so they only grow like counters.
+ */
+struct LatencyTotals
+{
+    std::uint64_t count{ 0 }; ///< Number of latencies recorded.
+    std::chrono::nanoseconds sum{ 0 }; ///< Sum of the latencies recorded.
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Lock-free histogram of latencies with a bounded relative error, HDR style.
+ *
+ * Latencies below 64ns have a bucket each; above, every power of two is split into
+ * 32 buckets, which bounds the relative error by 1/32 up to about 9.7 hours. Recording
+ * is a few relaxed atomic increments. A reader may run concurrently with writers and
+ * sees each latency either entirely or not at all, bucket by bucket.
+ */
+class DLL_API LatencyHistogram
+{
+public:
+    /**
+     * @class Timer
+     * @brief Records the time elapsed between its construction and its destruction.
+     */
+    class Timer
+    {
+    public:
+        /**
+         * @brief Starts timing.
+         * @param histogram The histogram to record into.
+         */
+        explicit Timer(LatencyHistogram& histogram) : m_histogram{ histogram }, m_started{ std::chrono::steady_clock::now() } {}
+
+        /**
+         * @brief Records the elapsed time.
+         */
+        ~Timer() { m_histogram.record(std::chrono::steady_clock::now() - m_started); }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        LatencyHistogram& m_histogram; ///< The histogram to record into.
+        std::chrono::steady_clock::time_point m_started; ///< When timing started.
+    };
+
+    /**
+     * @brief Constructs an empty histogram.
+     */
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief Records a latency.
+     * @param latency The latency; negative values count as zero, values beyond the range as its end.
+     */
+    void record(std::chrono::nanoseconds latency);
+
+    /**
+     * @brief Retrieves a percentile of the latencies recorded.
+     * @param percentile The percentile in [0, 1], e.g. 0.99.
+     * @return The latency, zero when nothing was recorded.
+     */
+    std::chrono::nanoseconds percentile(double percentile) const;
+
+    /**
+     * @brief Retrieves the count and usual percentiles of the latencies recorded.
+     * @return The summary.
+     */
+    LatencySummary summary() const;
+
+    /**
+     * @brief Retrieves the summary and empties the histogram, without losing concurrent records.
+     *
+     * Calling it once per interval yields the percentiles of that interval.
+     * @return The summary of the latencies recorded since the previous drain or reset.
+     */
+    LatencySummary drain();
+
+    /**
+     * @brief Retrieves the count and sum of the latencies recorded, including the drained ones.
+     * @return The totals since construction or the last reset.
+     */
+    LatencyTotals totals() const;
+
+    /**
+     * @brief Empties the histogram and zeroes its totals.
+     */
+    void reset();
+
+private:
+    static constexpr int subBucketBits{ 5 }; ///< log2 of the number of buckets per power of two.
+    static constexpr std::uint64_t linearLimit{ std::uint64_t{ 1 } << (subBucketBits + 1) }; ///< Latencies below this have a bucket each.
+    static constexpr int maxExponent{ 44 }; ///< Exponent of the highest power of two tracked; the range ends below 2^45ns.
+    static constexpr size_t bucketCount{ linearLimit + (maxExponent - subBucketBits) * (size_t{ 1 } << subBucketBits) }; ///< Number of buckets.
+
+    using Counts = std::array<std::uint64_t, bucketCount>;
+
+    std::array<std::atomic<std::uint64_t>, bucketCount> m_buckets; ///< Latencies recorded per bucket.
+    std::atomic<std::uint64_t> m_sum; ///< Sum of the latencies recorded, in nanoseconds.
+    std::atomic<std::uint64_t> m_max; ///< Highest latency recorded, in nanoseconds.
+    std::atomic<std::uint64_t> m_totalCount; ///< Latencies recorded, not cleared by drain().
+    std::atomic<std::uint64_t> m_totalSum; ///< Sum of the latencies recorded in nanoseconds, not cleared by drain().
+
+    /**
+     * @brief Maps a latency to its bucket.
+     * @param nanoseconds The latency, in nanoseconds.
+     * @return The index of the bucket.
+     */
+    static size_t bucketOf(std::uint64_t nanoseconds);
+
+    /**
+     * @brief Retrieves the highest latency falling in a bucket.
+     * @param bucket The index of the bucket.
+     * @return The latency, in nanoseconds.
+     */
+    static std::uint64_t highestIn(size_t bucket);
+
+    /**
+     * @brief Finds a percentile in a copy of the buckets.
+     * @param counts The bucket counts.
+     * @param total The sum of the counts.
+     * @param max The highest latency recorded, which bounds the result.
+     * @param percentile The percentile in [0, 1].
+     * @return The latency, in nanoseconds.
+     */
+    static std::uint64_t percentileOf(const Counts& counts, std::uint64_t total, std::uint64_t max, double percentile);
+
+    /**
+     * @brief Builds a summary from a copy of the buckets.
+     * @param counts The bucket counts.
+     * @param sum The sum of the latencies.
+     * @param max The highest latency.
+     * @return The summary.
+     */
+    static LatencySummary summarize(const Counts& counts, std::uint64_t sum, std::uint64_t max);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ * @file Probes.h
+ * @brief Static tracepoints (USDT) on the transport and parser hot paths.
+ *
+ * Defining GOOGLEBOOKSAPI_ENABLE_USDT on a platform providing <sys/sdt.h> places a probe
+ * of the "googlebooks" provider at each site, which perf, bpftrace or SystemTap can attach
+ * to in a running process; a probe nobody is attached to is a single nop. Otherwise the
+ * probes compile to nothing and their arguments are not evaluated.
+ *
+ * Probes of a transfer and of its parsing fire on the calling thread:
+ * - request_start(resource, length): the resource, not NUL-terminated, before the transfer.
+ * - first_byte(): the first byte of the response body was received.
+ * - transfer_complete(result, status): the CURLcode and HTTP status of the transfer.
+ * - parse_start(size): the size of the body about to be parsed.
+ * - parse_end(size, parsed): the same size, and 1 when the body was valid JSON, 0 otherwise.
+ */
+
+#ifdef GOOGLEBOOKSAPI_ENABLE_USDT
+#include <sys/sdt.h>
+
+#define GOOGLEBOOKS_PROBE0(name) DTRACE_PROBE(googlebooks, name)
+#define GOOGLEBOOKS_PROBE1(name, arg1) DTRACE_PROBE1(googlebooks, name, arg1)
+#define GOOGLEBOOKS_PROBE2(name, arg1, arg2) DTRACE_PROBE2(googlebooks, name, arg1, arg2)
+#else
+#define GOOGLEBOOKS_PROBE0(name) ((void)0)
+#define GOOGLEBOOKS_PROBE1(name, arg1) ((void)0)
+#define GOOGLEBOOKS_PROBE2(name, arg1, arg2) ((void)0)
+#endif // GOOGLEBOOKSAPI_ENABLE_USDT
@@ -0,0 +1,114 @@
+#include "pch.h"
+
+#include <json/json.h>
+
+#include <algorithm>
+
+#include "QueryCache.h"
+
+using namespace std;
+
+QueryCache::QueryCache(const CachePolicy& policy) : m_policy{ policy }
+{
+}
+
+void QueryCache::setPolicy(const CachePolicy& policy)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_policy = policy;
+    evictOverflow();
+}
+
+CachePolicy QueryCache::policy() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_policy;
+}
+
+CacheLookup QueryCache::find(const string& key)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return {};
+
+    const auto now = Clock::now();
+    if (now >= it->second.discardAt)
+        return {};
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+
+    return { it->second.value, now >= it->second.expiresAt, it->second.validators };
+}
+
+CacheLookup QueryCache::peek(const string& key) const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return {};
+
+    return { it->second.value, Clock::now() >= it->second.expiresAt, it->second.validators };
+}
+
+void QueryCache::store(const string& key, shared_ptr<const CachedPage> value, bool negative, const HttpValidators& validators)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (m_policy.maxEntries == 0)
+        return;
+
+    Entry entry{ move(value), {}, {}, negative, validators, {} };
+    if (!startTtl(entry))
+        return;
+
+    if (auto it = m_entries.find(key); it != m_entries.end())
+    {
+        entry.lruPosition = it->second.lruPosition;
+        it->second = move(entry);
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+        return;
+    }
+
+    m_lru.push_front(key);
+    entry.lruPosition = m_lru.begin();
+    m_entries.emplace(key, move(entry));
+
+    evictOverflow();
+}
+
+void QueryCache::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+}
+
+size_t QueryCache::size() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+void QueryCache::evictOverflow()
+{
+    while (m_entries.size() > m_policy.maxEntries)
+    {
+        m_entries.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+}
+
+bool QueryCache::startTtl(Entry& entry) const
+{
+    const auto ttl = entry.negative ? m_policy.negativeTtl : m_policy.positiveTtl;
+    if (ttl.count() <= 0)
+        return false;
+
+    entry.expiresAt = Clock::now() + ttl;
+    entry.discardAt = entry.expiresAt + max(m_policy.staleGrace, chrono::milliseconds::zero());
+
+    return true;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "HttpTypes.h"
+
+namespace Json
+{
+    class Value;
+}
+
+/**
+ * @struct CachePolicy
+ * @brief Lifetime and size settings for cached search responses.
+ *
+ * Zero-result and not-found responses are kept for a shorter time than responses
+ * carrying volumes, so that a book added to the catalogue shows up reasonably soon.
+ * A TTL of zero disables caching for that kind of response.
+ *
+ * Once its TTL has elapsed an entry is still served for the stale grace period while
+ * a background refresh fetches a new copy. Past the grace period entries are no longer
+ * served by lookups but are kept until evicted, so that those carrying validators can
+ * be revalidated with a conditional request instead of being downloaded again, and so
+ * that an open circuit breaker can still fall back on them. A response the server
+ * confirms as unchanged is simply stored again, which restarts its TTL.
+ */
+struct CachePolicy
+{
+    std::chrono::milliseconds positiveTtl{ std::chrono::minutes{ 5 } }; ///< Lifetime of responses that contain at least one volume.
+    std::chrono::milliseconds negativeTtl{ std::chrono::minutes{ 1 } }; ///< Lifetime of zero-result and not-found responses.
+    size_t maxEntries{ 1024 }; ///< Maximum number of cached queries, least recently used are evicted first.
+    std::chrono::milliseconds staleGrace{ std::chrono::minutes{ 1 } }; ///< How long an expired entry may still be served while it is refreshed.
+    size_t maxVolumes{ 4096 }; ///< Maximum number of distinct volumes kept by id, least recently used are evicted first.
+};
+
+/**
+ * @struct CachedPage
+ * @brief A parsed response split into its envelope and its volumes.
+ *
+ * The volumes are shared with the volume cache, so a book appearing in several
+ * cached pages is held once. A single-volume response has no envelope.
+ */
+struct CachedPage
+{
+    std::shared_ptr<const Json::Value> envelope; ///< The response whose items keep only their query-specific members, such as searchInfo.
+    std::vector<std::shared_ptr<const Json::Value>> volumes; ///< The volumes of the items, in response order.
+};
+
+/**
+ * @struct CacheLookup
+ * @brief Outcome of a cache lookup.
+ */
+struct CacheLookup
+{
+    std::shared_ptr<const CachedPage> value; ///< The cached response, or nullptr on a miss.
+    bool stale{ false }; ///< True when the TTL has elapsed and the entry is served within its grace period.
+    HttpValidators validators; ///< Validators the response was stored with.
+
+    /**
+     * @brief Tells whether the lookup found an entry.
+     */
+    explicit operator bool() const { return value != nullptr; }
+};
+
+/**
+ * @class QueryCache
+ * @brief Thread-safe LRU cache of parsed responses keyed by resource.
+ */
+class QueryCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Constructs an empty cache with the given policy.
+     * @param policy The lifetime and size settings.
+     */
+    explicit QueryCache(const CachePolicy& policy = {});
+
+    /**
+     * @brief Replaces the cache policy. Entries already stored keep their expiry time.
+     * @param policy The new lifetime and size settings.
+     */
+    void setPolicy(const CachePolicy& policy);
+
+    /**
+     * @brief Retrieves the current cache policy.
+     * @return The lifetime and size settings.
+     */
+    CachePolicy policy() const;
+
+    /**
+     * @brief Looks up an entry that is fresh or within its stale grace period.
+     * @param key The resource.
+     * @return The cached response and whether it is stale; empty when absent or past its grace period.
+     */
+    CacheLookup find(const std::string& key);
+
+    /**
+     * @brief Looks up an entry whatever its age, without affecting recency.
+     *
+     * Used to retrieve the validators of an expired entry before revalidating it, and
+     * the entry itself when the circuit breaker is open.
+     * @param key The resource.
+     * @return The cached response and its validators; empty when absent.
+     */
+    CacheLookup peek(const std::string& key) const;
+
+    /**
+     * @brief Stores a response using the TTL that matches its kind.
+     * @param key The resource.
+     * @param value The parsed response.
+     * @param negative True for zero-result and not-found responses.
+     * @param validators The validators sent with the response.
+     */
+    void store(const std::string& key, std::shared_ptr<const CachedPage> value, bool negative, const HttpValidators& validators = {});
+
+    /**
+     * @brief Removes every entry.
+     */
+    void clear();
+
+    /**
+     * @brief Retrieves the number of stored entries, including expired ones not yet evicted.
+     * @return The number of entries.
+     */
+    size_t size() const;
+
+private:
+    /**
+     * @struct Entry
+     * @brief A cached response and its bookkeeping.
+     */
+    struct Entry
+    {
+        std::shared_ptr<const CachedPage> value; ///< The parsed response.
+        Clock::time_point expiresAt; ///< Point in time after which the entry is stale.
+        Clock::time_point discardAt; ///< Point in time after which the entry is no longer served.
+        bool negative; ///< True for zero-result and not-found responses.
+        HttpValidators validators; ///< Validators the response was stored with.
+        std::list<std::string>::iterator lruPosition; ///< Position of the key in the recency list.
+    };
+
+    mutable std::mutex m_mutex; ///< Guards every member below.
+    CachePolicy m_policy; ///< The lifetime and size settings.
+    std::list<std::string> m_lru; ///< Keys ordered from most to least recently used.
+    std::unordered_map<std::string, Entry> m_entries; ///< Entries keyed by resource.
+
+    /**
+     * @brief Evicts least recently used entries until the size limit is honoured.
+     */
+    void evictOverflow();
+
+    /**
+     * @brief Sets the expiry times of an entry from now.
+     * @param entry The entry to update.
+     * @return False when the TTL for the kind of entry is zero.
+     */
+    bool startTtl(Entry& entry) const;
+};
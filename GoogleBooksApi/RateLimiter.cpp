@@ -0,0 +1,99 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "RateLimiter.h"
+
+using namespace std;
+
+RateLimiter::RateLimiter(const RateLimitPolicy& policy) : m_interval{ 0 }, m_tolerance{ 0 }, m_maxWait{ 0 },
+    m_mode{ RateLimitMode::Queue }, m_burst{ 1.0 }, m_nextArrival{ 0 }, m_waits{ 0 }, m_waited{ 0 }, m_rejections{ 0 }
+{
+    setPolicy(policy);
+}
+
+RateLimiter& RateLimiter::shared()
+{
+    static RateLimiter limiter;
+    return limiter;
+}
+
+void RateLimiter::setPolicy(const RateLimitPolicy& policy)
+{
+    const auto interval = policy.requestsPerSecond > 0.0 ? static_cast<int64_t>(1e9 / policy.requestsPerSecond) : 0;
+    const auto burst = max(policy.burst, 1.0);
+
+    m_tolerance.store(static_cast<int64_t>((burst - 1.0) * interval), memory_order_relaxed);
+    m_maxWait.store(chrono::duration_cast<chrono::nanoseconds>(policy.maxWait).count(), memory_order_relaxed);
+    m_mode.store(policy.mode, memory_order_relaxed);
+    m_burst.store(burst, memory_order_relaxed);
+    m_interval.store(interval, memory_order_release);
+}
+
+RateLimitPolicy RateLimiter::policy() const
+{
+    const auto interval = m_interval.load(memory_order_acquire);
+
+    RateLimitPolicy policy;
+    policy.requestsPerSecond = interval > 0 ? 1e9 / interval : 0.0;
+    policy.burst = m_burst.load(memory_order_relaxed);
+    policy.mode = m_mode.load(memory_order_relaxed);
+    policy.maxWait = chrono::duration_cast<chrono::milliseconds>(chrono::nanoseconds{ m_maxWait.load(memory_order_relaxed) });
+
+    return policy;
+}
+
+bool RateLimiter::acquire(chrono::steady_clock::time_point deadline)
+{
+    const auto interval = m_interval.load(memory_order_acquire);
+    if (interval <= 0)
+        return true;
+
+    const auto tolerance = m_tolerance.load(memory_order_relaxed);
+    auto maxWait = m_mode.load(memory_order_relaxed) == RateLimitMode::FailFast ? 0 : m_maxWait.load(memory_order_relaxed);
+    const auto current = now();
+
+    if (deadline != Clock::time_point::max())
+        maxWait = min(maxWait, chrono::duration_cast<chrono::nanoseconds>(deadline.time_since_epoch()).count() - current);
+
+    auto nextArrival = m_nextArrival.load(memory_order_relaxed);
+    for (;;)
+    {
+        const auto arrival = max(nextArrival, current);
+        const auto wait = arrival - tolerance - current;
+
+        if (wait > maxWait)
+        {
+            m_rejections.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+
+        if (m_nextArrival.compare_exchange_weak(nextArrival, arrival + interval, memory_order_relaxed))
+        {
+            if (wait > 0)
+            {
+                m_waits.fetch_add(1, memory_order_relaxed);
+                m_waited.fetch_add(wait, memory_order_relaxed);
+                this_thread::sleep_for(chrono::nanoseconds{ wait });
+            }
+
+            return true;
+        }
+    }
+}
+
+RateLimitStats RateLimiter::stats() const
+{
+    RateLimitStats stats;
+    stats.waits = m_waits.load(memory_order_relaxed);
+    stats.waited = chrono::nanoseconds{ m_waited.load(memory_order_relaxed) };
+    stats.rejections = m_rejections.load(memory_order_relaxed);
+
+    return stats;
+}
+
+int64_t RateLimiter::now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "DllApi.h"
+
+/**
+ * @enum RateLimitMode
+ * @brief Behavior of a request finding no token available.
+ */
+enum class RateLimitMode
+{
+    Queue, ///< Wait for the next token, up to the policy's maximum wait.
+    FailFast ///< Give up at once.
+};
+
+/**
+ * @struct RateLimitPolicy
+ * @brief Rate and burst of the requests sent to the API.
+ */
+struct RateLimitPolicy
+{
+    double requestsPerSecond{ 0.0 }; ///< Sustained rate at which tokens are added. Zero or less disables the limiter.
+    double burst{ 1.0 }; ///< Number of tokens the bucket holds, i.e. requests that may be sent back to back.
+    RateLimitMode mode{ RateLimitMode::Queue }; ///< What to do when the bucket is empty.
+    std::chrono::milliseconds maxWait{ std::chrono::seconds{ 30 } }; ///< Longest wait in Queue mode; requests that would wait longer fail.
+};
+
+/**
+ * @struct RateLimitStats
+ * @brief What the limiter did to the requests it saw.
+ */
+struct RateLimitStats
+{
+    std::uint64_t waits{ 0 }; ///< Requests that had to wait for a token.
+    std::chrono::nanoseconds waited{ 0 }; ///< Total time spent waiting for tokens.
+    std::uint64_t rejections{ 0 }; ///< Requests refused because no token could be had in time.
+};
+
+/**
+ * @class RateLimiter
+ * @brief Token bucket limiting the rate of requests.
+ *
+ * The bucket is kept as the theoretical arrival time of the next request (GCRA), so
+ * taking a token is a single compare-and-swap and no lock is held while waiting.
+ * Queued callers reserve their slot before sleeping and are served in the order
+ * they reserved it. The shared instance throttles every GoogleBooksInterface of the
+ * process, which is what the API quota counts.
+ */
+class DLL_API RateLimiter
+{
+public:
+    /**
+     * @brief Constructs a limiter.
+     * @param policy The rate, burst and mode; disabled by default.
+     */
+    explicit RateLimiter(const RateLimitPolicy& policy = {});
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    /**
+     * @brief Retrieves the limiter shared by every interface of the process.
+     * @return The shared limiter.
+     */
+    static RateLimiter& shared();
+
+    /**
+     * @brief Replaces the policy, keeping the tokens already spent.
+     * @param policy The new rate, burst and mode.
+     */
+    void setPolicy(const RateLimitPolicy& policy);
+
+    /**
+     * @brief Retrieves the current policy.
+     * @return A copy of the policy.
+     */
+    RateLimitPolicy policy() const;
+
+    /**
+     * @brief Takes a token, waiting for one in Queue mode.
+     * @param deadline Time past which the caller cannot wait, whatever the maximum wait.
+     * @return True once a token was taken, false if none is available and the mode, maximum wait or deadline forbids waiting.
+     */
+    bool acquire(std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    /**
+     * @brief Retrieves the waits and rejections since the limiter was constructed.
+     * @return The counters.
+     */
+    RateLimitStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<int64_t> m_interval; ///< Nanoseconds between two tokens, zero when disabled.
+    std::atomic<int64_t> m_tolerance; ///< Nanoseconds a request may run ahead of the sustained rate, i.e. the burst.
+    std::atomic<int64_t> m_maxWait; ///< Longest wait in Queue mode, in nanoseconds.
+    std::atomic<RateLimitMode> m_mode; ///< What to do when the bucket is empty.
+    std::atomic<double> m_burst; ///< The burst of the policy, kept to report it.
+    std::atomic<int64_t> m_nextArrival; ///< Theoretical arrival time of the next request, in nanoseconds of the steady clock.
+    std::atomic<uint64_t> m_waits; ///< Requests that had to wait for a token.
+    std::atomic<int64_t> m_waited; ///< Total time spent waiting for tokens, in nanoseconds.
+    std::atomic<uint64_t> m_rejections; ///< Requests refused.
+
+    /**
+     * @brief Retrieves the current time.
+     * @return Nanoseconds of the steady clock.
+     */
+    static int64_t now();
+};
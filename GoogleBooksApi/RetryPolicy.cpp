@@ -0,0 +1,67 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <random>
+
+#include "RetryPolicy.h"
+
+using namespace std;
+
+chrono::milliseconds RetryPolicy::backoff(int retry, chrono::milliseconds retryAfter) const
+{
+    if (retryAfter.count() > 0)
+        return retryAfter <= maxDelay ? retryAfter : chrono::milliseconds{ -1 };
+
+    thread_local minstd_rand generator{ random_device{}() };
+
+    const auto ceiling = min(maxDelay.count(), baseDelay.count() << min(retry - 1, 30));
+    uniform_int_distribution<long long> jitter{ 0, max<long long>(ceiling, 0) };
+
+    return chrono::milliseconds{ jitter(generator) };
+}
+
+RetryBudget::RetryBudget(double ratio, double cap) : m_deposit{ 0 }, m_cap{ 0 }, m_balance{ 0 }
+{
+    configure(ratio, cap);
+}
+
+RetryBudget& RetryBudget::shared()
+{
+    static RetryBudget budget;
+    return budget;
+}
+
+void RetryBudget::configure(double ratio, double cap)
+{
+    m_deposit.store(static_cast<int64_t>(max(ratio, 0.0) * scale), memory_order_relaxed);
+    m_cap.store(static_cast<int64_t>(max(cap, 0.0) * scale), memory_order_relaxed);
+    m_balance.store(m_cap.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+void RetryBudget::recordRequest()
+{
+    const auto deposit = m_deposit.load(memory_order_relaxed);
+    const auto cap = m_cap.load(memory_order_relaxed);
+
+    auto balance = m_balance.load(memory_order_relaxed);
+    while (balance < cap && !m_balance.compare_exchange_weak(balance, min(balance + deposit, cap), memory_order_relaxed))
+    {
+    }
+}
+
+bool RetryBudget::tryWithdraw()
+{
+    auto balance = m_balance.load(memory_order_relaxed);
+    while (balance >= scale)
+    {
+        if (m_balance.compare_exchange_weak(balance, balance - scale, memory_order_relaxed))
+            return true;
+    }
+
+    return false;
+}
+
+double RetryBudget::balance() const
+{
+    return static_cast<double>(m_balance.load(memory_order_relaxed)) / scale;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "DllApi.h"
+
+/**
+ * @struct RetryPolicy
+ * @brief Retries of transient failures: connection resets, timeouts, 429 and 5xx responses.
+ */
+struct DLL_API RetryPolicy
+{
+    int maxAttempts{ 3 }; ///< Attempts per request including the first one; 1 disables retries.
+    std::chrono::milliseconds baseDelay{ 100 }; ///< Backoff ceiling of the first retry, doubled for each further retry.
+    std::chrono::milliseconds maxDelay{ 10000 }; ///< Largest wait before a retry; a longer Retry-After gives up instead.
+
+    /**
+     * @brief Computes the wait before a retry.
+     *
+     * Without Retry-After the wait is drawn uniformly between zero and the exponential
+     * ceiling ("full jitter"), which spreads out the retries of clients that failed together.
+     * @param retry The number of the retry, starting at 1.
+     * @param retryAfter The wait requested by the server, zero when it requested none.
+     * @return The wait, or a negative duration when the server asks for longer than maxDelay.
+     */
+    std::chrono::milliseconds backoff(int retry, std::chrono::milliseconds retryAfter) const;
+};
+
+/**
+ * @class RetryBudget
+ * @brief Caps retries to a fraction of the requests, so a failing upstream does not cause a retry storm.
+ *
+ * Each request deposits ratio of a token and each retry withdraws a whole one, up to a
+ * balance of cap tokens. An idle process may therefore retry cap times in a row, while
+ * under sustained failure retries add at most ratio to the traffic. The balance is a
+ * single atomic.
+ */
+class DLL_API RetryBudget
+{
+public:
+    /**
+     * @brief Constructs a full budget.
+     * @param ratio Retries allowed per request under sustained failure.
+     * @param cap Largest number of retries that can be saved up.
+     */
+    explicit RetryBudget(double ratio = 0.1, double cap = 10.0);
+
+    RetryBudget(const RetryBudget&) = delete;
+    RetryBudget& operator=(const RetryBudget&) = delete;
+
+    /**
+     * @brief Retrieves the budget shared by every interface of the process.
+     * @return The shared budget.
+     */
+    static RetryBudget& shared();
+
+    /**
+     * @brief Replaces the ratio and cap and refills the budget.
+     * @param ratio Retries allowed per request under sustained failure.
+     * @param cap Largest number of retries that can be saved up.
+     */
+    void configure(double ratio, double cap);
+
+    /**
+     * @brief Deposits the share of a new request.
+     */
+    void recordRequest();
+
+    /**
+     * @brief Withdraws one retry.
+     * @return True if the budget allowed the retry.
+     */
+    bool tryWithdraw();
+
+    /**
+     * @brief Retrieves the number of retries currently allowed.
+     * @return The balance in retries.
+     */
+    double balance() const;
+
+private:
+    static constexpr int64_t scale{ 1000 }; ///< Fixed-point units per retry.
+
+    std::atomic<int64_t> m_deposit; ///< Units deposited per request.
+    std::atomic<int64_t> m_cap; ///< Largest balance in units.
+    std::atomic<int64_t> m_balance; ///< Current balance in units.
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "Cancellation.h"
+#include "HttpTypes.h"
+
+/**
+ * @enum VolumeProjection
+ * @brief Representation of the volumes returned by the API.
+ */
+enum class VolumeProjection
+{
+    Full, ///< All volume metadata.
+    Lite ///< A subset of volumeInfo and accessInfo, noticeably smaller to transfer and parse.
+};
+
+/**
+ * @struct SearchOptions
+ * @brief Per-call options of the search methods.
+ *
+ * Setting fields or the lite projection asks the API for a partial response, which
+ * shrinks both the transfer and the parse work. Partial volumes are cached with the
+ * query that produced them but never stored in the volume cache.
+ *
+ * The deadline and the cancellation token bound the call without changing what is
+ * requested: a transfer still running when either fires is aborted.
+ */
+struct SearchOptions
+{
+    std::string fields; ///< Partial response selector sent as fields=, e.g. "totalItems,items(id,volumeInfo/title)". Empty for all fields.
+    VolumeProjection projection{ VolumeProjection::Full }; ///< Representation of the returned volumes.
+    std::chrono::steady_clock::time_point deadline{ std::chrono::steady_clock::time_point::max() }; ///< Time at which the call gives up. No deadline by default.
+    CancellationToken cancellation{}; ///< Token whose cancellation makes the call give up.
+    TransferTiming* timing{ nullptr }; ///< When set, receives the timing of the transfer that produced the result, shared or not.
+
+    /**
+     * @brief Builds options selecting the given members of each volume.
+     *
+     * The envelope members kind and totalItems are always kept.
+     * @tparam Paths A range of strings such as "id" or "volumeInfo/title".
+     * @param paths The member paths of a volume to keep.
+     * @return Options carrying the matching fields selector.
+     */
+    template <typename Paths>
+    static SearchOptions selecting(const Paths& paths)
+    {
+        SearchOptions options;
+        options.fields = "kind,totalItems,items(";
+
+        auto first{ true };
+        for (const auto& path : paths)
+        {
+            if (!first)
+                options.fields += ',';
+
+            options.fields += path;
+            first = false;
+        }
+
+        options.fields += ')';
+
+        return options;
+    }
+
+    /**
+     * @brief Builds options selecting the members a record type reads.
+     *
+     * The record declares the volume members it is built from as a static range of
+     * strings named volumeFields, e.g.
+     * static constexpr const char* volumeFields[]{ "id", "volumeInfo/title", "volumeInfo/authors" };
+     * @tparam Record The record type.
+     * @return Options carrying the matching fields selector.
+     */
+    template <typename Record>
+    static SearchOptions selecting()
+    {
+        return selecting(Record::volumeFields);
+    }
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Cancellation.h"
+
+/**
+ * @brief Collapses identical concurrent calls into a single execution.
+ *
+ * The first caller for a key runs the work; callers arriving with the same key while
+ * it is in flight wait for it and receive the same result, or the same exception.
+ * The key is forgotten as soon as the work completes, so later calls run it again.
+ * The caller running the work returns as soon as it publishes the result; the last
+ * waiter to take it recycles the map node, and the nodes of completed calls are reused
+ * so a warmed-up instance starts a call without allocating.
+ *
+ * @tparam Key The type identifying identical calls.
+ * @tparam Value The type of the shared result. It is copied to every waiter, so it should be cheap to copy.
+ */
+template <typename Key, typename Value>
+class SingleFlight
+{
+public:
+    /**
+     * @brief Runs the work for the key, or joins the execution already in flight.
+     * @param key The key identifying identical calls.
+     * @param work The callable producing the result.
+     * @return The result produced by the single execution.
+     */
+    template <typename Work>
+    Value run(const Key& key, Work&& work)
+    {
+        return run(key, std::forward<Work>(work), std::chrono::steady_clock::time_point::max(), CancellationToken{}, [] { return Value{}; });
+    }
+
+    /**
+     * @brief Runs the work for the key, or joins the execution already in flight until its caller gives up.
+     * @param key The key identifying identical calls.
+     * @param work The callable producing the result.
+     * @param deadline Time past which a joining caller stops waiting. The work itself is not bounded.
+     * @param cancellation Stops a joining caller waiting once cancelled, observed every few milliseconds.
+     * @param abandoned The callable invoked instead of waiting past the deadline or the cancellation; its result is returned, or it throws.
+     * @return The result produced by the single execution.
+     */
+    template <typename Work, typename Abandoned>
+    Value run(const Key& key, Work&& work, std::chrono::steady_clock::time_point deadline, const CancellationToken& cancellation,
+        Abandoned&& abandoned)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (auto it = m_calls.find(key); it != m_calls.end())
+        {
+            // The node outlives its detachment from the map until every waiter has taken the result.
+            auto& call = it->second;
+            if (!join(lock, call, deadline, cancellation))
+                return abandoned();
+
+            return take(lock, call);
+        }
+
+        auto& call = start(key);
+        lock.unlock();
+
+        try
+        {
+            auto value = work();
+            finish(key, call, value, nullptr);
+            return value;
+        }
+        catch (...)
+        {
+            finish(key, call, Value{}, std::current_exception());
+            throw;
+        }
+    }
+
+    /**
+     * @brief Retrieves the number of executions currently in flight.
+     * @return The number of distinct keys being worked on.
+     */
+    size_t inFlight() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_calls.size();
+    }
+
+private:
+    /**
+     * @brief State of one execution shared with its waiters.
+     */
+    struct Call
+    {
+        Value value{}; ///< The result, once done.
+        std::exception_ptr error; ///< The exception thrown by the work, once done.
+        size_t waiters{ 0 }; ///< Callers blocked on this execution.
+        bool done{ false }; ///< Whether the work has completed.
+    };
+
+    using Calls = std::unordered_map<Key, Call>;
+
+    static constexpr size_t maxSpareCalls{ 64 }; ///< Completed nodes kept for reuse.
+    static constexpr std::chrono::milliseconds cancellationPoll{ 10 }; ///< Longest wait before a cancellable waiter checks its token again.
+
+    mutable std::mutex m_mutex; ///< Guards the calls and their state.
+    std::condition_variable m_changed; ///< Signalled when a call completes.
+    Calls m_calls; ///< Calls in flight keyed by their key.
+    std::vector<typename Calls::node_type> m_finished; ///< Nodes of completed calls whose waiters have not all taken the result.
+    std::vector<typename Calls::node_type> m_spare; ///< Nodes of completed calls, ready for reuse.
+
+    /**
+     * @brief Registers a new call, reusing a spare node when there is one.
+     * @param key The key of the call.
+     * @return The state of the call.
+     */
+    Call& start(const Key& key)
+    {
+        if (m_spare.empty())
+            return m_calls.try_emplace(key).first->second;
+
+        auto node = std::move(m_spare.back());
+        m_spare.pop_back();
+        node.key() = key;
+
+        return m_calls.insert(std::move(node)).position->second;
+    }
+
+    /**
+     * @brief Waits for a call in flight.
+     *
+     * Nothing signals a cancellation, so a cancellable waiter wakes up periodically to check it.
+     * @param lock The lock on the calls, held on return when the call completed, released otherwise.
+     * @param call The call to join.
+     * @param deadline Time past which the wait is abandoned.
+     * @param cancellation Abandons the wait once cancelled.
+     * @return True when the call completed, false when the deadline passed or the caller cancelled first.
+     */
+    bool join(std::unique_lock<std::mutex>& lock, Call& call, std::chrono::steady_clock::time_point deadline,
+        const CancellationToken& cancellation)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        ++call.waiters;
+
+        if (deadline == Clock::time_point::max() && !cancellation.cancellable())
+        {
+            m_changed.wait(lock, [&call] { return call.done; });
+            return true;
+        }
+
+        while (!call.done)
+        {
+            if (cancellation.cancelled() || Clock::now() >= deadline)
+            {
+                // The call is still in flight, so its node is not waiting on this caller.
+                --call.waiters;
+                lock.unlock();
+                return false;
+            }
+
+            const auto wake = cancellation.cancellable() ? std::min(deadline, Clock::now() + cancellationPoll) : deadline;
+            m_changed.wait_until(lock, wake);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Takes the result of a joined call once it completed.
+     * @param lock The lock on the calls, held.
+     * @param call The completed call.
+     * @return The result of the call.
+     */
+    Value take(std::unique_lock<std::mutex>& lock, Call& call)
+    {
+        auto value = call.value;
+        auto error = call.error;
+
+        if (--call.waiters == 0)
+        {
+            // The last waiter out recycles the node the work published its result in.
+            const auto node = std::find_if(m_finished.begin(), m_finished.end(),
+                [&call](const typename Calls::node_type& finished) { return &finished.mapped() == &call; });
+            recycle(std::move(*node));
+            m_finished.erase(node);
+        }
+
+        lock.unlock();
+
+        if (error)
+            std::rethrow_exception(error);
+
+        return value;
+    }
+
+    /**
+     * @brief Publishes the result of a call without waiting for its waiters to take it.
+     * @param key The key of the completed call.
+     * @param call The state of the call.
+     * @param value The result.
+     * @param error The exception thrown by the work, or null.
+     */
+    void finish(const Key& key, Call& call, const Value& value, std::exception_ptr error)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        call.value = value;
+        call.error = std::move(error);
+        call.done = true;
+
+        // Detaching the node makes the next caller start a new execution while waiters still read this one.
+        auto node = m_calls.extract(key);
+        if (call.waiters == 0)
+        {
+            recycle(std::move(node));
+            return;
+        }
+
+        m_finished.push_back(std::move(node));
+        m_changed.notify_all();
+    }
+
+    /**
+     * @brief Keeps the node of a completed call for reuse, unless enough are kept already.
+     * @param node The node, whose waiters have all taken the result.
+     */
+    void recycle(typename Calls::node_type&& node)
+    {
+        if (m_spare.size() < maxSpareCalls)
+        {
+            node.mapped() = Call{};
+            m_spare.push_back(std::move(node));
+        }
+    }
+};
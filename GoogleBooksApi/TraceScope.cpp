@@ -0,0 +1,11 @@
+#include "pch.h"
+
+#include "TraceScope.h"
+
+#ifndef GOOGLEBOOKSAPI_DISABLE_TRACING
+TraceScope*& TraceScope::active()
+{
+    thread_local TraceScope* scope{ nullptr };
+    return scope;
+}
+#endif // GOOGLEBOOKSAPI_DISABLE_TRACING
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "Tracing.h"
+
+/**
+ * @class TraceScope
+ * @brief Span of the library code running on this thread, ended when the scope exits.
+ *
+ * A root scope starts a span on the tracer it is given; the scopes opened while it is
+ * alive, on the same thread, become its children. Without a root, or without a tracer,
+ * a scope costs a thread-local read. Defining GOOGLEBOOKSAPI_DISABLE_TRACING compiles
+ * every scope to nothing.
+ */
+class TraceScope
+{
+public:
+#ifndef GOOGLEBOOKSAPI_DISABLE_TRACING
+    /**
+     * @brief Opens the scope of a call.
+     * @param tracer The tracer receiving the spans of the call, null for none.
+     * @param name The name of the span.
+     */
+    TraceScope(std::shared_ptr<Tracer> tracer, std::string_view name) : m_root{ std::move(tracer) }, m_tracer{ m_root.get() }
+    {
+        open(name);
+    }
+
+    /**
+     * @brief Opens a child of the scope active on this thread, if any.
+     * @param name The name of the span.
+     */
+    explicit TraceScope(std::string_view name) : m_tracer{ active() ? active()->m_tracer : nullptr }
+    {
+        open(name);
+    }
+
+    /**
+     * @brief Ends the span and makes the enclosing scope active again.
+     */
+    ~TraceScope()
+    {
+        if (m_span)
+            active() = m_enclosing;
+    }
+
+    /**
+     * @brief Retrieves the scope with a span innermost on this thread.
+     * @return The scope, null when no span is being recorded.
+     */
+    static TraceScope* current() { return active(); }
+
+    /**
+     * @brief Attaches a text attribute to the span.
+     * @param key The attribute name.
+     * @param value The attribute value.
+     */
+    void setAttribute(std::string_view key, std::string_view value)
+    {
+        if (m_span)
+            m_span->setAttribute(key, value);
+    }
+
+    /**
+     * @brief Attaches a numeric attribute to the span.
+     * @param key The attribute name.
+     * @param value The attribute value.
+     */
+    void setAttribute(std::string_view key, std::int64_t value)
+    {
+        if (m_span)
+            m_span->setAttribute(key, value);
+    }
+
+    /**
+     * @brief Marks the span as failed.
+     * @param message The description of the failure.
+     */
+    void setError(std::string_view message)
+    {
+        if (m_span)
+            m_span->setError(message);
+    }
+#else
+    TraceScope(const std::shared_ptr<Tracer>&, std::string_view) {}
+    explicit TraceScope(std::string_view) {}
+    static TraceScope* current() { return nullptr; }
+    void setAttribute(std::string_view, std::string_view) {}
+    void setAttribute(std::string_view, std::int64_t) {}
+    void setError(std::string_view) {}
+#endif // GOOGLEBOOKSAPI_DISABLE_TRACING
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+#ifndef GOOGLEBOOKSAPI_DISABLE_TRACING
+private:
+    std::shared_ptr<Tracer> m_root; ///< Keeps the tracer alive for the whole call, set on the root scope only.
+    Tracer* m_tracer; ///< The tracer of the call, null when it is not traced.
+    TraceScope* m_enclosing{ nullptr }; ///< The scope active when this one opened.
+    std::unique_ptr<TraceSpan> m_span; ///< The span, null when not recorded.
+
+    /**
+     * @brief Starts the span and makes this scope the active one.
+     * @param name The name of the span.
+     */
+    void open(std::string_view name)
+    {
+        if (!m_tracer)
+            return;
+
+        m_enclosing = active();
+        m_span = m_tracer->startSpan(name, m_enclosing ? m_enclosing->m_span.get() : nullptr);
+        if (m_span)
+            active() = this;
+    }
+
+    /**
+     * @brief Retrieves the active scope of this thread.
+     * @return A reference to the thread's active scope pointer.
+     */
+    static TraceScope*& active();
+#endif // GOOGLEBOOKSAPI_DISABLE_TRACING
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+/**
+ * @class TraceSpan
+ * @brief A timed operation reported to a Tracer, ended when destroyed.
+ *
+ * Implementations adapt it to a tracing system such as OpenTelemetry. Attribute keys
+ * and values are only valid during the call and must be copied if kept.
+ */
+class TraceSpan
+{
+public:
+    virtual ~TraceSpan() = default;
+
+    /**
+     * @brief Attaches a text attribute, e.g. the search method.
+     * @param key The attribute name.
+     * @param value The attribute value.
+     */
+    virtual void setAttribute(std::string_view key, std::string_view value) = 0;
+
+    /**
+     * @brief Attaches a numeric attribute, e.g. the HTTP status.
+     * @param key The attribute name.
+     * @param value The attribute value.
+     */
+    virtual void setAttribute(std::string_view key, std::int64_t value) = 0;
+
+    /**
+     * @brief Marks the operation as failed.
+     * @param message The description of the failure.
+     */
+    virtual void setError(std::string_view message) = 0;
+};
+
+/**
+ * @class Tracer
+ * @brief Receives the spans of a GoogleBooksInterface.
+ *
+ * Every search method starts a span named "googlebooks.search", with children named
+ * "googlebooks.queue" for the wait on the rate limiter and concurrency window,
+ * "googlebooks.transport" for each transfer and "googlebooks.parse" for parsing.
+ * Background refreshes start a "googlebooks.refresh" span instead. Spans are
+ * started and ended on the thread of the call.
+ */
+class Tracer
+{
+public:
+    virtual ~Tracer() = default;
+
+    /**
+     * @brief Starts a span.
+     * @param name The name of the operation.
+     * @param parent The enclosing span of the same call, null for the span of the call itself.
+     * @return The span, or null to skip the operation and its children.
+     */
+    virtual std::unique_ptr<TraceSpan> startSpan(std::string_view name, TraceSpan* parent) = 0;
+};
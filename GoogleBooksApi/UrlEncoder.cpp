@@ -0,0 +1,136 @@
+#include "pch.h"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define URLENCODER_SSE2
+#    include <emmintrin.h>
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#    endif // _MSC_VER
+#endif // SSE2
+
+#include "UrlEncoder.h"
+
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Builds the classification table of RFC 3986 unreserved characters.
+     * @return The table, indexed by unsigned byte value.
+     */
+    constexpr array<bool, 256> makeUnreservedTable()
+    {
+        array<bool, 256> table{};
+
+        for (auto c = 'A'; c <= 'Z'; ++c)
+            table[static_cast<uint8_t>(c)] = true;
+        for (auto c = 'a'; c <= 'z'; ++c)
+            table[static_cast<uint8_t>(c)] = true;
+        for (auto c = '0'; c <= '9'; ++c)
+            table[static_cast<uint8_t>(c)] = true;
+
+        table['-'] = table['.'] = table['_'] = table['~'] = true;
+
+        return table;
+    }
+
+    constexpr auto unreservedTable = makeUnreservedTable();
+
+    constexpr char hexDigits[] = "0123456789ABCDEF";
+
+#ifdef URLENCODER_SSE2
+    /**
+     * @brief Marks the bytes of a block lying in an inclusive ASCII range.
+     * @param block Sixteen bytes.
+     * @param low The first byte of the range.
+     * @param high The last byte of the range.
+     * @return 0xFF in the lanes inside the range, 0x00 elsewhere.
+     */
+    inline __m128i inRange(__m128i block, char low, char high)
+    {
+        // Bytes above 0x7F compare as negative and therefore fall outside every ASCII range.
+        return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8(high + 1)));
+    }
+
+    /**
+     * @brief Counts the trailing zero bits of a non-zero mask.
+     * @param mask The mask.
+     * @return The index of its lowest set bit.
+     */
+    inline unsigned lowestSetBit(unsigned mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif // _MSC_VER
+    }
+#endif // URLENCODER_SSE2
+}
+
+void UrlEncoder::append(string_view data, string& out)
+{
+    out.reserve(out.size() + data.size());
+
+    auto first = data.data();
+    const auto last = first + data.size();
+
+    while (first != last)
+    {
+        const auto run = unreservedRun(first, last);
+        out.append(first, run);
+        first += run;
+
+        for (; first != last && !isUnreserved(*first); ++first)
+        {
+            const auto c = static_cast<uint8_t>(*first);
+            const char encoded[]{ '%', hexDigits[c >> 4], hexDigits[c & 0x0F] };
+            out.append(encoded, sizeof(encoded));
+        }
+    }
+}
+
+string UrlEncoder::encode(string_view data)
+{
+    string out;
+    append(data, out);
+    return out;
+}
+
+bool UrlEncoder::isUnreserved(char c)
+{
+    return unreservedTable[static_cast<uint8_t>(c)];
+}
+
+size_t UrlEncoder::unreservedRun(const char* first, const char* last)
+{
+    auto current = first;
+
+#ifdef URLENCODER_SSE2
+    for (; last - current >= 16; current += 16)
+    {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+
+        auto unreserved = _mm_or_si128(inRange(block, 'A', 'Z'), inRange(block, 'a', 'z'));
+        unreserved = _mm_or_si128(unreserved, inRange(block, '0', '9'));
+        unreserved = _mm_or_si128(unreserved, _mm_cmpeq_epi8(block, _mm_set1_epi8('-')));
+        unreserved = _mm_or_si128(unreserved, _mm_cmpeq_epi8(block, _mm_set1_epi8('.')));
+        unreserved = _mm_or_si128(unreserved, _mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+        unreserved = _mm_or_si128(unreserved, _mm_cmpeq_epi8(block, _mm_set1_epi8('~')));
+
+        const auto reserved = ~static_cast<unsigned>(_mm_movemask_epi8(unreserved)) & 0xFFFFu;
+        if (reserved)
+            return static_cast<size_t>(current - first) + lowestSetBit(reserved);
+    }
+#endif // URLENCODER_SSE2
+
+    while (current != last && isUnreserved(*current))
+        ++current;
+
+    return static_cast<size_t>(current - first);
+}
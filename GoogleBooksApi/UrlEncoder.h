@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "DllApi.h"
+
+/**
+ * @class UrlEncoder
+ * @brief RFC 3986 percent-encoder for URL query components.
+ *
+ * Unreserved characters (ALPHA, DIGIT, '-', '.', '_' and '~') are copied as is and
+ * every other byte becomes %XX with uppercase hex digits, so '&', '+', '#' and spaces
+ * in user text can no longer split or corrupt the query string. Classification uses a
+ * 256-entry table, and on SSE2 targets runs of unreserved characters are scanned
+ * sixteen bytes at a time.
+ */
+class DLL_API UrlEncoder
+{
+public:
+    /**
+     * @brief Appends the percent-encoding of the data to a string.
+     * @param data The raw bytes, typically UTF-8 text.
+     * @param out The string to append to.
+     */
+    static void append(std::string_view data, std::string& out);
+
+    /**
+     * @brief Percent-encodes the data.
+     * @param data The raw bytes, typically UTF-8 text.
+     * @return The encoded string.
+     */
+    static std::string encode(std::string_view data);
+
+    /**
+     * @brief Tells whether a byte is copied as is.
+     * @param c The byte.
+     * @return True for RFC 3986 unreserved characters.
+     */
+    static bool isUnreserved(char c);
+
+private:
+    /**
+     * @brief Measures the run of unreserved characters at the start of a range.
+     * @param first The start of the range.
+     * @param last The end of the range.
+     * @return The number of leading unreserved bytes.
+     */
+    static size_t unreservedRun(const char* first, const char* last);
+};
@@ -0,0 +1,78 @@
+#include "pch.h"
+
+#include <curl/curl.h>
+
+#include <memory>
+
+#include "UrlEncoder.h"
+#include "UrlTemplate.h"
+
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Releases a URL handle.
+     */
+    struct UrlDeleter
+    {
+        void operator()(CURLU* url) const { curl_url_cleanup(url); }
+    };
+
+    /**
+     * @brief Releases a string allocated by the curl URL API.
+     */
+    struct CurlStringDeleter
+    {
+        void operator()(char* text) const { curl_free(text); }
+    };
+}
+
+UrlTemplate::UrlTemplate() : m_endpoint{ defaultEndpoint }, m_keyParameter{}
+{
+}
+
+bool UrlTemplate::setEndpoint(const string& endpoint)
+{
+    unique_ptr<CURLU, UrlDeleter> url{ curl_url() };
+    if (!url || curl_url_set(url.get(), CURLUPART_URL, endpoint.c_str(), 0) != CURLUE_OK)
+        return false;
+
+    curl_url_set(url.get(), CURLUPART_QUERY, nullptr, 0);
+    curl_url_set(url.get(), CURLUPART_FRAGMENT, nullptr, 0);
+
+    char* text{ nullptr };
+    if (curl_url_get(url.get(), CURLUPART_URL, &text, 0) != CURLUE_OK)
+        return false;
+
+    unique_ptr<char, CurlStringDeleter> normalized{ text };
+
+    m_endpoint = normalized.get();
+    if (m_endpoint.back() != '/')
+        m_endpoint += '/';
+
+    return true;
+}
+
+void UrlTemplate::setApiKey(const string& apiKey)
+{
+    m_keyParameter.clear();
+
+    if (apiKey.empty())
+        return;
+
+    m_keyParameter = "key=";
+    UrlEncoder::append(apiKey, m_keyParameter);
+}
+
+void UrlTemplate::expand(string_view resource, string& url) const
+{
+    url.assign(m_endpoint);
+    url += resource;
+
+    if (m_keyParameter.empty())
+        return;
+
+    url += resource.find('?') == string_view::npos ? '?' : '&';
+    url += m_keyParameter;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "DllApi.h"
+
+/**
+ * @class UrlTemplate
+ * @brief Prebuilt request URL holding the API endpoint and key.
+ *
+ * The endpoint is parsed and normalized once with the curl URL API and the key is
+ * percent-encoded once, so expanding a request only splices its resource between
+ * the two. Pointing the endpoint at a mirror or a local mock server redirects every
+ * request of the interface.
+ */
+class DLL_API UrlTemplate
+{
+public:
+    static constexpr const char* defaultEndpoint{ "https://www.googleapis.com/books/v1/" }; ///< The public Google Books API root.
+
+    /**
+     * @brief Constructs a template for the public Google Books API without a key.
+     */
+    UrlTemplate();
+
+    /**
+     * @brief Sets the root that resources are appended to.
+     *
+     * Any query or fragment of the endpoint is dropped and the path is given a trailing slash.
+     * @param endpoint An absolute URL, e.g. "http://127.0.0.1:8080/books/v1/".
+     * @return False, leaving the template unchanged, when the endpoint is not a valid absolute URL.
+     */
+    bool setEndpoint(const std::string& endpoint);
+
+    /**
+     * @brief Sets the API key sent with every request.
+     * @param apiKey The key, or an empty string to send none.
+     */
+    void setApiKey(const std::string& apiKey);
+
+    /**
+     * @brief Retrieves the normalized endpoint.
+     * @return The root that resources are appended to, ending with a slash.
+     */
+    const std::string& endpoint() const { return m_endpoint; }
+
+    /**
+     * @brief Builds the URL of a resource.
+     * @param resource The path and query relative to the API root, e.g. "volumes?q=isbn:9780553804577".
+     * @param url Receives the URL; its storage is reused.
+     */
+    void expand(std::string_view resource, std::string& url) const;
+
+private:
+    std::string m_endpoint; ///< The normalized root, ending with a slash.
+    std::string m_keyParameter; ///< "key=" followed by the encoded key, empty without a key.
+};
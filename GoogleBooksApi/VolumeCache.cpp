@@ -0,0 +1,186 @@
+#include "pch.h"
+
+#include <json/json.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "VolumeCache.h"
+
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Strips hyphens and spaces from an ISBN.
+     * @param isbn The ISBN as typed or as returned by the API.
+     * @return The bare digits (and trailing X) of the ISBN.
+     */
+    string normalizeIsbn(const string& isbn)
+    {
+        string normalized;
+        normalized.reserve(isbn.size());
+
+        copy_if(isbn.begin(), isbn.end(), back_inserter(normalized), [](char c) { return c != '-' && c != ' '; });
+
+        return normalized;
+    }
+
+    /**
+     * @brief Collects the ISBN-10 and ISBN-13 identifiers of a volume.
+     * @param volume The volume.
+     * @return The normalized ISBNs.
+     */
+    vector<string> isbnsOf(const Json::Value& volume)
+    {
+        vector<string> isbns;
+
+        for (const auto& identifier : volume["volumeInfo"]["industryIdentifiers"])
+        {
+            const auto type = identifier["type"].asString();
+            if (type == "ISBN_10" || type == "ISBN_13")
+                isbns.push_back(normalizeIsbn(identifier["identifier"].asString()));
+        }
+
+        return isbns;
+    }
+}
+
+VolumeCache::VolumeCache(const CachePolicy& policy) : m_policy{ policy }
+{
+}
+
+void VolumeCache::setPolicy(const CachePolicy& policy)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_policy = policy;
+    evictOverflow();
+}
+
+shared_ptr<const Json::Value> VolumeCache::store(Json::Value volume, VolumeSource source)
+{
+    if (!volume.isObject() || !volume["id"].isString())
+        return nullptr;
+
+    const auto id = volume["id"].asString();
+
+    lock_guard<mutex> lock(m_mutex);
+
+    if (m_policy.positiveTtl.count() <= 0 || m_policy.maxVolumes == 0)
+        return make_shared<const Json::Value>(move(volume));
+
+    const auto expiresAt = Clock::now() + m_policy.positiveTtl;
+
+    if (auto it = m_entries.find(id); it != m_entries.end())
+    {
+        auto& entry = it->second;
+
+        // A search item must not replace the full volume that later lookups by id rely on.
+        if (source < entry.source && Clock::now() < entry.expiresAt)
+            return make_shared<const Json::Value>(move(volume));
+
+        entry.expiresAt = expiresAt;
+        entry.source = source;
+        m_lru.splice(m_lru.begin(), m_lru, entry.lruPosition);
+
+        if (*entry.value == volume)
+            return entry.value;
+
+        for (const auto& isbn : entry.isbns)
+        {
+            if (auto indexed = m_isbnIndex.find(isbn); indexed != m_isbnIndex.end() && indexed->second == id)
+                m_isbnIndex.erase(indexed);
+        }
+
+        entry.isbns = isbnsOf(volume);
+        entry.value = make_shared<const Json::Value>(move(volume));
+
+        for (const auto& isbn : entry.isbns)
+            m_isbnIndex[isbn] = id;
+
+        return entry.value;
+    }
+
+    m_lru.push_front(id);
+    auto isbns = isbnsOf(volume);
+    auto& entry = m_entries.emplace(id, Entry{ make_shared<const Json::Value>(move(volume)), expiresAt, source, move(isbns), m_lru.begin() }).first->second;
+
+    for (const auto& isbn : entry.isbns)
+        m_isbnIndex[isbn] = id;
+
+    auto value = entry.value;
+
+    evictOverflow();
+
+    return value;
+}
+
+shared_ptr<const Json::Value> VolumeCache::findById(const string& id, VolumeSource minimum)
+{
+    lock_guard<mutex> lock(m_mutex);
+    return findLocked(id, minimum);
+}
+
+shared_ptr<const Json::Value> VolumeCache::findByIsbn(const string& isbn, VolumeSource minimum)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto it = m_isbnIndex.find(normalizeIsbn(isbn));
+    if (it == m_isbnIndex.end())
+        return nullptr;
+
+    return findLocked(it->second, minimum);
+}
+
+void VolumeCache::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_entries.clear();
+    m_isbnIndex.clear();
+    m_lru.clear();
+}
+
+size_t VolumeCache::size() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+shared_ptr<const Json::Value> VolumeCache::findLocked(const string& id, VolumeSource minimum)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return nullptr;
+
+    if (Clock::now() >= it->second.expiresAt)
+    {
+        erase(it);
+        return nullptr;
+    }
+
+    if (it->second.source < minimum)
+        return nullptr;
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+
+    return it->second.value;
+}
+
+void VolumeCache::erase(unordered_map<string, Entry>::iterator it)
+{
+    for (const auto& isbn : it->second.isbns)
+    {
+        // Another volume may have claimed the ISBN since.
+        if (auto indexed = m_isbnIndex.find(isbn); indexed != m_isbnIndex.end() && indexed->second == it->first)
+            m_isbnIndex.erase(indexed);
+    }
+
+    m_lru.erase(it->second.lruPosition);
+    m_entries.erase(it);
+}
+
+void VolumeCache::evictOverflow()
+{
+    while (m_entries.size() > m_policy.maxVolumes)
+        erase(m_entries.find(m_lru.back()));
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "QueryCache.h"
+
+namespace Json
+{
+    class Value;
+}
+
+/**
+ * @enum VolumeSource
+ * @brief Kind of response a cached volume was taken from, from the least to the most complete.
+ */
+enum class VolumeSource
+{
+    Lite, ///< The lite projection; such volumes are not cached, but any cached volume answers a request for one.
+    Search, ///< An item of a full search response, which leaves some details of the volume out.
+    Volume ///< A full volumes/{id} response.
+};
+
+/**
+ * @class VolumeCache
+ * @brief Thread-safe LRU cache of volumes keyed by volume id, with an ISBN index.
+ *
+ * Every search response is split into its volumes, which are interned here: a volume
+ * seen again with the same content keeps its existing copy, so a book returned by
+ * several queries is held once. Volumes live for the positive TTL of the cache policy.
+ * Each volume remembers the response it came from, so that a lookup is only answered
+ * with a volume at least as complete as the one it asks for.
+ */
+class VolumeCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Constructs an empty cache with the given policy.
+     * @param policy The lifetime and size settings.
+     */
+    explicit VolumeCache(const CachePolicy& policy = {});
+
+    /**
+     * @brief Replaces the cache policy. Volumes already stored keep their expiry time.
+     * @param policy The new lifetime and size settings.
+     */
+    void setPolicy(const CachePolicy& policy);
+
+    /**
+     * @brief Interns a volume, restarting its TTL.
+     *
+     * A volume less complete than the live copy already stored is not interned, so that
+     * the copy keeps answering the lookups that need it.
+     * @param volume A volume as found in the items of a search response, without its searchInfo, or a volume response.
+     * @param source The kind of response the volume was taken from.
+     * @return The shared copy of the volume, or nullptr when it has no id.
+     */
+    std::shared_ptr<const Json::Value> store(Json::Value volume, VolumeSource source);
+
+    /**
+     * @brief Looks up a live volume by id.
+     * @param id The volume id.
+     * @param minimum The least complete kind of response that answers the lookup.
+     * @return The volume, or nullptr when absent, expired or less complete than asked for.
+     */
+    std::shared_ptr<const Json::Value> findById(const std::string& id, VolumeSource minimum);
+
+    /**
+     * @brief Looks up a live volume by ISBN-10 or ISBN-13.
+     * @param isbn The ISBN, hyphens and spaces are ignored.
+     * @param minimum The least complete kind of response that answers the lookup.
+     * @return The volume, or nullptr when absent, expired or less complete than asked for.
+     */
+    std::shared_ptr<const Json::Value> findByIsbn(const std::string& isbn, VolumeSource minimum);
+
+    /**
+     * @brief Removes every volume.
+     */
+    void clear();
+
+    /**
+     * @brief Retrieves the number of stored volumes, including expired ones not yet evicted.
+     * @return The number of volumes.
+     */
+    size_t size() const;
+
+private:
+    /**
+     * @struct Entry
+     * @brief A cached volume and its bookkeeping.
+     */
+    struct Entry
+    {
+        std::shared_ptr<const Json::Value> value; ///< The volume.
+        Clock::time_point expiresAt; ///< Point in time after which the volume is no longer served.
+        VolumeSource source; ///< Kind of response the volume was taken from.
+        std::vector<std::string> isbns; ///< ISBNs of the volume registered in the index.
+        std::list<std::string>::iterator lruPosition; ///< Position of the id in the recency list.
+    };
+
+    mutable std::mutex m_mutex; ///< Guards every member below.
+    CachePolicy m_policy; ///< The lifetime and size settings.
+    std::list<std::string> m_lru; ///< Volume ids ordered from most to least recently used.
+    std::unordered_map<std::string, Entry> m_entries; ///< Volumes keyed by id.
+    std::unordered_map<std::string, std::string> m_isbnIndex; ///< Volume ids keyed by normalized ISBN.
+
+    /**
+     * @brief Looks up a live volume by id, the mutex being held.
+     * @param id The volume id.
+     * @param minimum The least complete kind of response that answers the lookup.
+     * @return The volume, or nullptr when absent, expired or less complete than asked for.
+     */
+    std::shared_ptr<const Json::Value> findLocked(const std::string& id, VolumeSource minimum);
+
+    /**
+     * @brief Removes a volume and its ISBN index entries, the mutex being held.
+     * @param it The volume to remove.
+     */
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+    /**
+     * @brief Evicts least recently used volumes until the size limit is honoured.
+     */
+    void evictOverflow();
+};
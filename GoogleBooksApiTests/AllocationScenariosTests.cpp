@@ -0,0 +1,181 @@
+#include "pch.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <crtdbg.h>
+#endif // _MSC_VER
+
+#include <json/json.h>
+#include "GoogleBooksInterface.h"
+
+namespace AllocationScenarios
+{
+	thread_local bool counting{ false };
+	thread_local size_t allocations{ 0 };
+}
+
+#if defined(_MSC_VER) && !defined(_DEBUG)
+// Release CRTs have no allocation hook, so these tests would pass without counting anything.
+#ifdef GTEST_SKIP
+#define SKIP_WITHOUT_ALLOCATION_HOOK() GTEST_SKIP() << "The release CRT has no allocation hook"
+#define ALLOCATION_TEST(name) TEST(TestAllocations, name)
+#else
+// gtest 1.8 cannot skip a test once it runs, so the tests are reported as disabled instead.
+#define SKIP_WITHOUT_ALLOCATION_HOOK() ((void)0)
+#define ALLOCATION_TEST(name) TEST(TestAllocations, DISABLED_##name)
+#endif // GTEST_SKIP
+#else
+#define SKIP_WITHOUT_ALLOCATION_HOOK() ((void)0)
+#define ALLOCATION_TEST(name) TEST(TestAllocations, name)
+#endif // _MSC_VER && !_DEBUG
+
+#ifdef _MSC_VER
+// The DLL has its own operator new, so allocations are observed on the debug CRT heap both modules share.
+int countingAllocHook(int allocType, void*, size_t, int blockType, long, const unsigned char*, int)
+{
+	if (AllocationScenarios::counting && blockType != _CRT_BLOCK && (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC))
+		++AllocationScenarios::allocations;
+
+	return 1;
+}
+#else
+void* operator new(size_t size)
+{
+	if (AllocationScenarios::counting)
+		++AllocationScenarios::allocations;
+
+	if (auto memory = malloc(size ? size : 1))
+		return memory;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+// Sized deallocation goes through the same replacement, so each block is freed as it was allocated.
+void operator delete(void* memory, size_t) noexcept
+{
+	::operator delete(memory);
+}
+#endif // _MSC_VER
+
+namespace AllocationScenarios
+{
+	using namespace std;
+
+	const string NoBooksFound = R"({"kind":"books#volumes","totalItems":0})";
+
+	const string VolumeNotFound = R"({"error":{"code":404,"message":"The volume ID could not be found."}})";
+
+	// Counts the heap allocations of the calling thread while in scope.
+	class AllocationCounter
+	{
+	public:
+		AllocationCounter()
+		{
+#ifdef _MSC_VER
+			_CrtSetAllocHook(countingAllocHook);
+#endif // _MSC_VER
+			allocations = 0;
+			counting = true;
+		}
+
+		~AllocationCounter()
+		{
+			counting = false;
+		}
+	};
+
+	class ProbingGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		size_t allocationsBeforeTransfer{ 0 };
+		int requests{ 0 };
+
+		ProbingGoogleBooksInterface()
+		{
+			// Without a cache every call goes all the way to the transport.
+			setCachePolicy({ chrono::minutes{ 5 }, chrono::minutes{ 1 }, 0 });
+		}
+
+		HttpResponse httpRequest(const HttpRequest& request) override
+		{
+			allocationsBeforeTransfer = allocations;
+			++requests;
+
+			if (request.resource.rfind("volumes/", 0) == 0)
+				return { 404, VolumeNotFound };
+
+			return { 200, NoBooksFound };
+		}
+	};
+
+	ALLOCATION_TEST(WarmSearchAllocatesNothingBeforeTheTransfer)
+	{
+		SKIP_WITHOUT_ALLOCATION_HOOK();
+
+		auto gbIf = ProbingGoogleBooksInterface{};
+
+		auto options = SearchOptions{};
+		options.fields = "kind,totalItems,items(id,volumeInfo/title,volumeInfo/authors)";
+
+		const auto query = BooksQuery{}
+			.term("a term much longer than any small string buffer")
+			.inAuthor("Ken Follett, who also needs a heap allocation")
+			.subject("fiction")
+			.filter(BooksQuery::Filter::Ebooks)
+			.langRestrict("pt")
+			.startIndex(120)
+			.maxResults(40)
+			.options(options);
+
+		gbIf.search(query);
+		gbIf.search(query);
+
+		for (auto i = 0; i < 3; ++i)
+		{
+			AllocationCounter counter;
+			gbIf.search(query);
+			ASSERT_EQ(0u, gbIf.allocationsBeforeTransfer);
+		}
+
+		ASSERT_EQ(5, gbIf.requests);
+	}
+
+	ALLOCATION_TEST(WarmSingleQualifierSearchAllocatesNothingBeforeTheTransfer)
+	{
+		SKIP_WITHOUT_ALLOCATION_HOOK();
+
+		auto gbIf = ProbingGoogleBooksInterface{};
+		const auto term = "The Pillars of the Earth and its sequels"s;
+		const auto author = "Ken Follett and Friends Ltd"s;
+
+		gbIf.getAllBooksByAuthor(term, author, 100, 20);
+
+		for (auto startIndex = 20; startIndex <= 60; startIndex += 20)
+		{
+			AllocationCounter counter;
+			gbIf.getAllBooksByAuthor(term, author, startIndex, 20);
+			ASSERT_EQ(0u, gbIf.allocationsBeforeTransfer);
+		}
+	}
+
+	ALLOCATION_TEST(WarmVolumeLookupAllocatesNothingBeforeTheTransfer)
+	{
+		SKIP_WITHOUT_ALLOCATION_HOOK();
+
+		auto gbIf = ProbingGoogleBooksInterface{};
+		const auto volumeId = "anUnknownVolumeIdentifier"s;
+
+		gbIf.getVolumeById(volumeId);
+
+		AllocationCounter counter;
+		gbIf.getVolumeById(volumeId);
+		ASSERT_EQ(0u, gbIf.allocationsBeforeTransfer);
+	}
+}
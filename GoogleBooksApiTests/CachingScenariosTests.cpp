@@ -0,0 +1,372 @@
+#include "pch.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+#include "GoogleBooksInterface.h"
+
+namespace CachingScenarios
+{
+	using namespace std;
+
+	const string NoBooksFound = R"({"kind":"books#volumes","totalItems":0})";
+
+	const string OneBookFound = R"({"kind":"books#volumes","totalItems":1,
+"items":[{"kind":"books#volume","id":"zyTCAlFPjgYC","volumeInfo":{"title":"The Google Story",
+"industryIdentifiers":[{"type":"ISBN_10","identifier":"055380457X"},{"type":"ISBN_13","identifier":"9780553804577"}]},
+"searchInfo":{"textSnippet":"The Google Story"}}]})";
+
+	const string GoogleStoryVolume = R"({"kind":"books#volume","id":"zyTCAlFPjgYC","volumeInfo":{"title":"The Google Story"}})";
+
+	const string VolumeNotFound = R"({"error":{"code":404,"message":"The volume ID could not be found."}})";
+
+	const string InvalidKeyMessage = R"({"error":{"code":400,"message":"API key not valid. Please pass a valid API key."}})";
+
+	struct BookSummary
+	{
+		static constexpr const char* volumeFields[]{ "id", "volumeInfo/title", "volumeInfo/authors" };
+	};
+
+	class CountingGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		atomic<int> requests{ 0 };
+		string lastResource;
+
+		HttpResponse httpRequest(const HttpRequest& request) override
+		{
+			++requests;
+			lastResource = request.resource;
+
+			if (request.resource.find("UnknownAuthor") != string::npos)
+				return { 200, NoBooksFound };
+
+			if (request.resource.find("InvalidKey") != string::npos)
+				return { 400, InvalidKeyMessage };
+
+			if (request.resource.rfind("volumes/unknown", 0) == 0)
+				return { 404, VolumeNotFound };
+
+			if (request.resource.rfind("volumes/", 0) == 0)
+				return { 200, GoogleStoryVolume };
+
+			return { 200, OneBookFound };
+		}
+	};
+
+	class SlowGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		atomic<int> requests{ 0 };
+
+		HttpResponse httpRequest(const HttpRequest&) override
+		{
+			++requests;
+			this_thread::sleep_for(chrono::milliseconds{ 200 });
+
+			return { 200, OneBookFound };
+		}
+	};
+
+	class TimedGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		atomic<int> requests{ 0 };
+
+		HttpResponse httpRequest(const HttpRequest&) override
+		{
+			++requests;
+			this_thread::sleep_for(chrono::milliseconds{ 100 });
+
+			auto response = HttpResponse{ 200, OneBookFound };
+			response.timing.startTransfer = chrono::milliseconds{ 90 };
+			response.timing.total = chrono::milliseconds{ 100 };
+			response.timing.bytesDownloaded = OneBookFound.size();
+			response.timing.connectionReused = true;
+
+			return response;
+		}
+	};
+
+	class RevalidatingGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		int requests{ 0 };
+		int parses{ 0 };
+		string lastIfNoneMatch;
+
+		HttpResponse httpRequest(const HttpRequest& request) override
+		{
+			++requests;
+			lastIfNoneMatch = request.conditional.etag;
+
+			if (request.conditional.etag == "\"v1\"")
+				return { 304, {}, { "\"v1\"" } };
+
+			return { 200, OneBookFound, { "\"v1\"" } };
+		}
+
+		Json::Value parseResponse(const std::string& response) override
+		{
+			++parses;
+			return GoogleBooksInterface::parseResponse(response);
+		}
+	};
+
+	TEST(TestCaching, RepeatedQueryIsServedFromCache)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		auto first = gbIf.getAllBooksByTitle("google", "The Google Story");
+		auto second = gbIf.getAllBooksByTitle("google", "The Google Story");
+
+		ASSERT_EQ(1, gbIf.requests.load());
+		ASSERT_EQ(first, second);
+	}
+
+	TEST(TestCaching, NotFoundQueryIsServedFromCache)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		gbIf.getAllBooksByAuthor("general term", "UnknownAuthor");
+		auto books = gbIf.getAllBooksByAuthor("general term", "UnknownAuthor");
+
+		ASSERT_EQ(1, gbIf.requests.load());
+		ASSERT_EQ(0, books["totalItems"].asInt());
+	}
+
+	TEST(TestCaching, NegativeTtlIsIndependentOfPositiveTtl)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		gbIf.setCachePolicy({ chrono::seconds{ 300 }, chrono::seconds{ 0 } });
+
+		gbIf.getAllBooksByAuthor("general term", "UnknownAuthor");
+		gbIf.getAllBooksByAuthor("general term", "UnknownAuthor");
+		gbIf.getAllBooksByTerm("google");
+		gbIf.getAllBooksByTerm("google");
+
+		ASSERT_EQ(3, gbIf.requests.load());
+	}
+
+	TEST(TestCaching, ErrorResponseIsNotCached)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		gbIf.getAllBooksByTerm("InvalidKey");
+		auto books = gbIf.getAllBooksByTerm("InvalidKey");
+
+		ASSERT_EQ(2, gbIf.requests.load());
+		ASSERT_EQ(400, books["error"]["code"].asInt());
+	}
+
+	TEST(TestCaching, ConcurrentIdenticalQueriesShareOneTransfer)
+	{
+		auto gbIf = SlowGoogleBooksInterface{};
+		gbIf.setCachePolicy({ chrono::seconds{ 0 }, chrono::seconds{ 0 } });
+
+		vector<Json::Value> results(8);
+		vector<thread> callers;
+
+		for (auto& result : results)
+			callers.emplace_back([&gbIf, &result] { result = gbIf.getAllBooksByAuthor("google", "David A. Vise"); });
+
+		for (auto& caller : callers)
+			caller.join();
+
+		ASSERT_EQ(1, gbIf.requests.load());
+
+		for (const auto& result : results)
+			ASSERT_EQ(1, result["totalItems"].asInt());
+	}
+
+	TEST(TestCaching, StaleEntryIsServedWhileRefreshedInBackground)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		gbIf.setCachePolicy({ chrono::milliseconds{ 50 }, chrono::milliseconds{ 50 }, 16, chrono::seconds{ 30 } });
+
+		gbIf.getAllBooksByTerm("google");
+		this_thread::sleep_for(chrono::milliseconds{ 100 });
+
+		auto books = gbIf.getAllBooksByTerm("google");
+		ASSERT_EQ(1, books["totalItems"].asInt());
+
+		for (int i = 0; i < 100 && gbIf.requests < 2; ++i)
+			this_thread::sleep_for(chrono::milliseconds{ 10 });
+
+		ASSERT_EQ(2, gbIf.requests.load());
+	}
+
+	TEST(TestCaching, ExpiredEntryIsRevalidatedWithoutReparsing)
+	{
+		auto gbIf = RevalidatingGoogleBooksInterface{};
+		gbIf.setCachePolicy({ chrono::milliseconds{ 50 }, chrono::milliseconds{ 50 }, 16, chrono::milliseconds{ 0 } });
+
+		auto first = gbIf.getAllBooksByIsbn("9780553804577");
+		this_thread::sleep_for(chrono::milliseconds{ 100 });
+		auto second = gbIf.getAllBooksByIsbn("9780553804577");
+
+		ASSERT_EQ(2, gbIf.requests);
+		ASSERT_EQ("\"v1\""s, gbIf.lastIfNoneMatch);
+		ASSERT_EQ(1, gbIf.parses);
+		ASSERT_EQ(first, second);
+	}
+
+	TEST(TestCaching, IsbnLookupIsAnsweredFromVolumesOfEarlierSearches)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		auto search = gbIf.getAllBooksByAuthor("google", "David A. Vise");
+		auto books = gbIf.getAllBooksByIsbn("978-0-553-80457-7");
+
+		ASSERT_EQ(1, gbIf.requests.load());
+		ASSERT_EQ(1, books["totalItems"].asInt());
+		ASSERT_EQ("zyTCAlFPjgYC"s, books["items"][0]["id"].asString());
+		ASSERT_EQ("The Google Story"s, search["items"][0]["searchInfo"]["textSnippet"].asString());
+
+		// Later pages are the API's to answer.
+		gbIf.getAllBooksByIsbn("978-0-553-80457-7", 1, 10);
+		ASSERT_EQ(2, gbIf.requests.load());
+	}
+
+	TEST(TestCaching, IsbnLookupWithOptionsIsNotAnsweredWithAFullVolume)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		gbIf.getAllBooksByAuthor("google", "David A. Vise");
+
+		gbIf.getAllBooksByIsbn("978-0-553-80457-7", SearchOptions::selecting<BookSummary>());
+		ASSERT_EQ(2, gbIf.requests.load());
+		ASSERT_NE(string::npos, gbIf.lastResource.find("&fields="));
+
+		gbIf.getAllBooksByIsbn("9780553804577", SearchOptions{ {}, VolumeProjection::Lite });
+		ASSERT_EQ(3, gbIf.requests.load());
+		ASSERT_NE(string::npos, gbIf.lastResource.find("&projection=lite"));
+
+		auto options = SearchOptions{};
+		options.deadline = chrono::steady_clock::now();
+		ASSERT_THROW(gbIf.getAllBooksByIsbn("9780553804577", options), GoogleBooksCancelledException);
+		ASSERT_EQ(3, gbIf.requests.load());
+	}
+
+	TEST(TestCaching, VolumeLookupIsServedFromVolumeCache)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		auto first = gbIf.getVolumeById("zyTCAlFPjgYC");
+		auto second = gbIf.getVolumeById("zyTCAlFPjgYC");
+
+		ASSERT_EQ(1, gbIf.requests.load());
+		ASSERT_EQ("The Google Story"s, second["volumeInfo"]["title"].asString());
+		ASSERT_EQ(first, second);
+	}
+
+	TEST(TestCaching, VolumeSeenInSearchNeedsNoRequest)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		gbIf.getAllBooksByTerm("google");
+		auto volume = gbIf.getVolumeById("zyTCAlFPjgYC", VolumeProjection::Lite);
+
+		ASSERT_EQ(1, gbIf.requests.load());
+		ASSERT_FALSE(volume.isMember("searchInfo"));
+	}
+
+	TEST(TestCaching, FullVolumeLookupIsNotAnsweredWithASearchItem)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		// Only the volume cache answers, so that every search is sent.
+		gbIf.setCachePolicy({ chrono::minutes{ 5 }, chrono::minutes{ 1 }, 0 });
+
+		gbIf.getAllBooksByTerm("google");
+		gbIf.getVolumeById("zyTCAlFPjgYC");
+		ASSERT_EQ(2, gbIf.requests.load());
+
+		// A later search does not demote the full volume.
+		gbIf.getAllBooksByAuthor("google", "David A. Vise");
+		gbIf.getVolumeById("zyTCAlFPjgYC");
+		gbIf.getVolumeById("zyTCAlFPjgYC", VolumeProjection::Lite);
+		ASSERT_EQ(3, gbIf.requests.load());
+	}
+
+	TEST(TestCaching, UnknownVolumeIsNegativelyCached)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		gbIf.getVolumeById("unknown");
+		auto volume = gbIf.getVolumeById("unknown");
+
+		ASSERT_EQ(1, gbIf.requests.load());
+		ASSERT_EQ(404, volume["error"]["code"].asInt());
+	}
+
+	TEST(TestCaching, PartialResponseIsRequestedAndNotSharedWithVolumeCache)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		GoogleBooksInterface& client = gbIf;
+
+		client.getAllBooksByTerm("google", SearchOptions::selecting<BookSummary>());
+		ASSERT_NE(string::npos, gbIf.lastResource.find("&fields=kind%2CtotalItems%2Citems%28id%2CvolumeInfo%2Ftitle%2CvolumeInfo%2Fauthors%29"));
+
+		client.getAllBooksByTitle("google", "The Google Story", SearchOptions{ {}, VolumeProjection::Lite });
+		ASSERT_NE(string::npos, gbIf.lastResource.find("&projection=lite"));
+
+		client.getVolumeById("zyTCAlFPjgYC");
+		ASSERT_EQ(3, gbIf.requests.load());
+	}
+
+	TEST(TestCaching, TransferTimingIsReportedAndEmptyForCacheHits)
+	{
+		auto gbIf = TimedGoogleBooksInterface{};
+		auto timing = TransferTiming{};
+
+		auto options = SearchOptions{};
+		options.timing = &timing;
+
+		gbIf.getAllBooksByTerm("google", options);
+		ASSERT_TRUE(timing.transferred);
+		ASSERT_EQ(chrono::microseconds{ chrono::milliseconds{ 100 } }, timing.total);
+		ASSERT_EQ(OneBookFound.size(), timing.bytesDownloaded);
+		ASSERT_TRUE(timing.connectionReused);
+
+		gbIf.getAllBooksByTerm("google", options);
+		ASSERT_FALSE(timing.transferred);
+		ASSERT_EQ(chrono::microseconds{ 0 }, timing.total);
+
+		// The volumes of the search answer a lookup of one of their ISBNs.
+		gbIf.getAllBooksByTerm("story", options);
+		ASSERT_TRUE(timing.transferred);
+
+		auto books = gbIf.getAllBooksByIsbn("9780553804577", options);
+		ASSERT_EQ(1, books["totalItems"].asInt());
+		ASSERT_FALSE(timing.transferred);
+		ASSERT_EQ(chrono::microseconds{ 0 }, timing.total);
+		ASSERT_EQ(2, gbIf.requests.load());
+	}
+
+	TEST(TestCaching, CallersSharingATransferReceiveItsTiming)
+	{
+		auto gbIf = TimedGoogleBooksInterface{};
+		gbIf.setCachePolicy({ chrono::seconds{ 0 }, chrono::seconds{ 0 } });
+
+		vector<TransferTiming> timings(4);
+		vector<thread> callers;
+
+		for (auto& timing : timings)
+			callers.emplace_back([&gbIf, &timing]
+				{
+					auto options = SearchOptions{};
+					options.timing = &timing;
+					gbIf.getAllBooksByTerm("google", options);
+				});
+
+		for (auto& caller : callers)
+			caller.join();
+
+		ASSERT_EQ(1, gbIf.requests.load());
+
+		for (const auto& timing : timings)
+			ASSERT_EQ(chrono::microseconds{ chrono::milliseconds{ 90 } }, timing.startTransfer);
+	}
+}
@@ -0,0 +1,142 @@
+#include "pch.h"
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <utility>
+
+#include <json/json.h>
+#include "GoogleBooksInterface.h"
+#include "MockGoogleBooksServer.h"
+
+namespace LoopbackScenarios
+{
+	using namespace std;
+
+	class LoopbackGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		explicit LoopbackGoogleBooksInterface(const MockGoogleBooksServer& server) : GoogleBooksInterface{ "NoEmptyKey" }
+		{
+			setEndpoint(server.endpoint());
+			// Every call goes over the loopback connection.
+			setCachePolicy({ chrono::minutes{ 5 }, chrono::minutes{ 1 }, 0 });
+			setRetryPolicy({ 3, chrono::milliseconds{ 1 }, chrono::milliseconds{ 10 } });
+		}
+	};
+
+	TEST(TestLoopbackServer, SearchesShareOneKeptAliveConnection)
+	{
+		MockGoogleBooksServer server;
+		server.setGeneratedPage(20, 1000);
+
+		auto gbIf = LoopbackGoogleBooksInterface{ server };
+
+		for (auto startIndex = 0; startIndex < 100; startIndex += 20)
+		{
+			auto books = gbIf.getAllBooksByAuthor("fiction", "Mock Author", startIndex, 20);
+			ASSERT_EQ(20u, books["items"].size());
+		}
+
+		const auto stats = gbIf.connectionStats();
+		ASSERT_EQ(5u, server.requests());
+		ASSERT_EQ(1u, server.connections());
+		ASSERT_EQ(1u, stats.opened);
+		ASSERT_EQ(4u, stats.reused);
+		ASSERT_EQ(1, stats.idle);
+
+		for (const auto& record : gbIf.flightRecorder().snapshot())
+			ASSERT_GT(record.timing.bytesDownloaded, 20u * 1000u);
+	}
+
+	TEST(TestLoopbackServer, InjectedFailuresAreRetried)
+	{
+		// Refills the process-wide budget that earlier retries drew from.
+		RetryBudget::shared().configure(0.1, 10);
+
+		MockGoogleBooksServer server;
+		server.injectErrors(2, 503);
+
+		auto gbIf = LoopbackGoogleBooksInterface{ server };
+
+		gbIf.getAllBooksByTerm("first");
+		auto books = gbIf.getAllBooksByTerm("second");
+
+		ASSERT_EQ(0, books["totalItems"].asInt());
+		ASSERT_EQ(3u, server.requests());
+
+		const auto records = gbIf.flightRecorder().snapshot();
+		ASSERT_EQ(3u, records.size());
+		ASSERT_EQ(503, records[1].status);
+		ASSERT_EQ(200, records[2].status);
+	}
+
+	TEST(TestLoopbackServer, InjectedLatencyIsMeasured)
+	{
+		MockGoogleBooksServer server;
+		server.setLatency(chrono::milliseconds{ 50 });
+
+		auto gbIf = LoopbackGoogleBooksInterface{ server };
+		gbIf.getAllBooksByTerm("slow");
+
+		ASSERT_GE(gbIf.latency(LatencyOperation::Transfer).summary().max, chrono::milliseconds{ 50 });
+		ASSERT_GE(gbIf.flightRecorder().snapshot().front().timing.startTransfer, chrono::milliseconds{ 50 });
+	}
+
+	TEST(TestLoopbackServer, WaitForTheSameInstanceIsNotMeasuredAsLatency)
+	{
+		MockGoogleBooksServer server;
+		server.setLatency(chrono::milliseconds{ 100 });
+
+		// A response slower than 1.5 times the first one would cut the window.
+		ConcurrencyLimiter::shared().setPolicy({ 4, 1, 64, 0.5, 1.5 });
+
+		auto gbIf = LoopbackGoogleBooksInterface{ server };
+		auto first = async(launch::async, [&gbIf] { return gbIf.getAllBooksByTerm("first"); });
+		auto second = async(launch::async, [&gbIf] { return gbIf.getAllBooksByTerm("second"); });
+		first.get();
+		second.get();
+
+		const auto limit = ConcurrencyLimiter::shared().limit();
+		ConcurrencyLimiter::shared().setPolicy({});
+
+		ASSERT_GT(limit, 4.0);
+		ASSERT_LT(gbIf.latency(LatencyOperation::Transfer).summary().max, chrono::milliseconds{ 150 });
+		for (const auto& record : gbIf.flightRecorder().snapshot())
+			ASSERT_LT(record.elapsed, chrono::milliseconds{ 150 });
+	}
+
+	TEST(TestLoopbackServer, HedgeWinsTheRaceAgainstAStalledRequest)
+	{
+		MockGoogleBooksServer server;
+		server.record("first", R"({"kind":"books#volumes","totalItems":1})");
+		server.record("second", R"({"kind":"books#volumes","totalItems":2})");
+		server.record("third", R"({"kind":"books#volumes","totalItems":3})");
+
+		// No deposit, so the two hedges an idle controller saves are all there is.
+		auto gbIf = LoopbackGoogleBooksInterface{ server };
+		gbIf.setHedgePolicy({ true, 0.5, 0.0, 5 });
+
+		for (auto i = 0; i < 5; ++i)
+			gbIf.getAllBooksByTerm("warmup" + to_string(i));
+
+		const auto stall = chrono::milliseconds{ 500 };
+		for (const auto& [term, total] : { pair<string, int>{ "first", 1 }, pair<string, int>{ "second", 2 } })
+		{
+			server.stall(term, stall);
+
+			const auto started = chrono::steady_clock::now();
+			ASSERT_EQ(total, gbIf.getAllBooksByTerm(term)["totalItems"].asInt());
+			ASSERT_LT(chrono::steady_clock::now() - started, stall / 2);
+		}
+
+		ASSERT_EQ(9u, server.requests());
+
+		server.stall("third", stall);
+
+		const auto started = chrono::steady_clock::now();
+		ASSERT_EQ(3, gbIf.getAllBooksByTerm("third")["totalItems"].asInt());
+		ASSERT_GE(chrono::steady_clock::now() - started, stall);
+		ASSERT_EQ(10u, server.requests());
+	}
+}
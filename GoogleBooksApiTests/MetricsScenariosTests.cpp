@@ -0,0 +1,447 @@
+#include "pch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+#include "GoogleBooksInterface.h"
+
+namespace MetricsScenarios
+{
+	using namespace std;
+
+	const string NoBooksFound = R"({"kind":"books#volumes","totalItems":0})";
+
+	const string InvalidKeyMessage = R"({"error":{"code":400,"message":"API key not valid. Please pass a valid API key."}})";
+
+	class CountingGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		int requests{ 0 };
+
+		HttpResponse httpRequest(const HttpRequest& request) override
+		{
+			auto response = HttpResponse{ 200, NoBooksFound };
+
+			if (request.resource.find("InvalidKey") != string::npos)
+				response = { 400, InvalidKeyMessage };
+			else if (request.resource.find("Unavailable") != string::npos)
+				response = { 503, {} };
+
+			response.timing.connectionReused = ++requests > 1;
+
+			return response;
+		}
+	};
+
+	struct RecordedSpan
+	{
+		string name;
+		string parent;
+		map<string, string> attributes;
+		string error;
+		bool ended{ false };
+	};
+
+	// Keeps every span it is given, in the order they started.
+	class RecordingTracer : public Tracer
+	{
+	public:
+		mutex spansMutex;
+		vector<shared_ptr<RecordedSpan>> spans;
+
+		class Span : public TraceSpan
+		{
+		public:
+			explicit Span(shared_ptr<RecordedSpan> span) : recorded{ move(span) } {}
+			~Span() override { recorded->ended = true; }
+
+			void setAttribute(string_view key, string_view value) override { recorded->attributes[string{ key }] = string{ value }; }
+			void setAttribute(string_view key, int64_t value) override { recorded->attributes[string{ key }] = to_string(value); }
+			void setError(string_view message) override { recorded->error = string{ message }; }
+
+			shared_ptr<RecordedSpan> recorded;
+		};
+
+		unique_ptr<TraceSpan> startSpan(string_view name, TraceSpan* parent) override
+		{
+			auto span = make_shared<RecordedSpan>();
+			span->name = string{ name };
+			if (parent)
+				span->parent = static_cast<Span*>(parent)->recorded->name;
+
+			lock_guard<mutex> lock(spansMutex);
+			spans.push_back(span);
+
+			return make_unique<Span>(span);
+		}
+	};
+
+	// Tells whether the rendered metrics contain a sample line.
+	bool hasSample(const string& metrics, const string& sample)
+	{
+		return metrics.find("\n" + sample + "\n") != string::npos;
+	}
+
+	TEST(TestLatencyHistogram, PercentilesAreWithinTheRelativeError)
+	{
+		auto histogram = LatencyHistogram{};
+
+		for (auto i = 1; i <= 10000; ++i)
+			histogram.record(chrono::microseconds{ i });
+
+		const auto summary = histogram.summary();
+		ASSERT_EQ(10000u, summary.count);
+		ASSERT_EQ(chrono::microseconds{ 10000 }, summary.max);
+
+		const pair<chrono::nanoseconds, chrono::nanoseconds> expected[]{
+			{ summary.p50, chrono::microseconds{ 5000 } },
+			{ summary.p90, chrono::microseconds{ 9000 } },
+			{ summary.p99, chrono::microseconds{ 9900 } },
+			{ summary.p999, chrono::microseconds{ 9990 } } };
+
+		for (const auto& [actual, exact] : expected)
+		{
+			ASSERT_GE(actual, exact);
+			ASSERT_LE(actual.count(), exact.count() + exact.count() / 32);
+		}
+	}
+
+	TEST(TestLatencyHistogram, ShortLatenciesAreExact)
+	{
+		auto histogram = LatencyHistogram{};
+
+		for (auto i = 1; i <= 40; ++i)
+			histogram.record(chrono::nanoseconds{ i });
+
+		ASSERT_EQ(chrono::nanoseconds{ 20 }, histogram.percentile(0.5));
+		ASSERT_EQ(chrono::nanoseconds{ 40 }, histogram.percentile(1.0));
+	}
+
+	TEST(TestLatencyHistogram, DrainReturnsTheIntervalAndEmptiesTheHistogram)
+	{
+		auto histogram = LatencyHistogram{};
+
+		histogram.record(chrono::milliseconds{ 3 });
+		histogram.record(chrono::milliseconds{ 5 });
+
+		const auto interval = histogram.drain();
+		ASSERT_EQ(2u, interval.count);
+		ASSERT_EQ(chrono::milliseconds{ 8 }, interval.sum);
+		ASSERT_EQ(chrono::milliseconds{ 5 }, interval.max);
+
+		ASSERT_EQ(0u, histogram.summary().count);
+		ASSERT_EQ(chrono::nanoseconds{ 0 }, histogram.percentile(0.99));
+	}
+
+	TEST(TestLatencyHistogram, TotalsKeepGrowingAcrossDrains)
+	{
+		auto histogram = LatencyHistogram{};
+
+		histogram.record(chrono::milliseconds{ 3 });
+		histogram.drain();
+		histogram.record(chrono::milliseconds{ 5 });
+
+		const auto totals = histogram.totals();
+		ASSERT_EQ(2u, totals.count);
+		ASSERT_EQ(chrono::milliseconds{ 8 }, totals.sum);
+		ASSERT_EQ(1u, histogram.summary().count);
+	}
+
+	TEST(TestLatencyHistogram, ConcurrentRecordsAreAllCounted)
+	{
+		auto histogram = LatencyHistogram{};
+		vector<thread> writers;
+
+		for (auto t = 0; t < 4; ++t)
+			writers.emplace_back([&histogram]
+				{
+					for (auto i = 0; i < 10000; ++i)
+						histogram.record(chrono::microseconds{ i % 500 });
+				});
+
+		for (auto& writer : writers)
+			writer.join();
+
+		ASSERT_EQ(40000u, histogram.summary().count);
+	}
+
+	TEST(TestLatencyHistogram, EachOperationHasItsOwnHistogram)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		gbIf.getAllBooksByTerm("google");
+		gbIf.getAllBooksByTerm("google");
+		gbIf.getAllBooksByAuthor("google", "David A. Vise");
+		gbIf.search(BooksQuery{}.subject("computers"));
+
+		ASSERT_EQ(2u, gbIf.latency(LatencyOperation::Term).summary().count);
+		ASSERT_EQ(1u, gbIf.latency(LatencyOperation::Author).summary().count);
+		ASSERT_EQ(1u, gbIf.latency(LatencyOperation::Query).summary().count);
+		ASSERT_EQ(0u, gbIf.latency(LatencyOperation::Subject).summary().count);
+
+		// The repeated term was answered from the cache, without transfer nor parse.
+		ASSERT_EQ(3u, gbIf.latency(LatencyOperation::Transfer).summary().count);
+		ASSERT_EQ(3u, gbIf.latency(LatencyOperation::Parse).summary().count);
+		ASSERT_EQ(3, gbIf.requests);
+	}
+
+	TEST(TestPrometheusMetrics, CountersAreRenderedInTheTextFormat)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		gbIf.setRetryPolicy({ 2, chrono::milliseconds{ 1 }, chrono::milliseconds{ 1 } });
+
+		gbIf.getAllBooksByTerm("google");
+		gbIf.getAllBooksByTerm("google");
+		gbIf.getAllBooksByTerm("InvalidKey");
+		gbIf.getAllBooksByAuthor("google", "Unavailable");
+		ASSERT_THROW(gbIf.search(BooksQuery{}), GoogleBooksInterfaceException);
+
+		const auto metrics = gbIf.prometheusMetrics();
+
+		ASSERT_NE(string::npos, metrics.find("# TYPE googlebooks_requests_total counter\n"));
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_requests_total{method="term",outcome="success"} 2)"));
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_requests_total{method="term",outcome="api_error"} 1)"));
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_requests_total{method="author",outcome="api_error"} 1)"));
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_requests_total{method="query",outcome="failure"} 1)"));
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_duration_seconds_count{operation="term"} 3)"));
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_duration_seconds_count{operation="parse"} 2)"));
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_cache_lookups_total{cache="query",result="hit"} 1)"));
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_cache_lookups_total{cache="query",result="miss"} 3)"));
+		ASSERT_TRUE(hasSample(metrics, "googlebooks_transfers_in_flight 0"));
+		ASSERT_TRUE(hasSample(metrics, "googlebooks_transfers_total 4"));
+		ASSERT_TRUE(hasSample(metrics, "googlebooks_received_bytes_total " + to_string(NoBooksFound.size() + InvalidKeyMessage.size())));
+		ASSERT_TRUE(hasSample(metrics, "googlebooks_connections_reused_total 3"));
+		ASSERT_TRUE(hasSample(metrics, "googlebooks_connection_reuse_ratio 0.75"));
+		ASSERT_TRUE(hasSample(metrics, "googlebooks_retries_total 1"));
+		ASSERT_NE(string::npos, metrics.find("\ngooglebooks_rate_limiter_waits_total "));
+	}
+
+	TEST(TestPrometheusMetrics, SummaryCountAndSumSurviveADrain)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		gbIf.getAllBooksByTerm("google");
+		gbIf.latency(LatencyOperation::Term).drain();
+		gbIf.latency(LatencyOperation::Term).record(chrono::nanoseconds{ 123456789 });
+
+		const auto metrics = gbIf.prometheusMetrics();
+
+		ASSERT_TRUE(hasSample(metrics, R"(googlebooks_duration_seconds_count{operation="term"} 2)"));
+		ASSERT_NE(string::npos, metrics.find("googlebooks_duration_seconds{operation=\"term\",quantile=\"0.5\"} 0.123456789"));
+	}
+
+	TEST(TestTracing, SearchHasChildSpansForQueueTransportAndParse)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		auto tracer = make_shared<RecordingTracer>();
+		gbIf.setTracer(tracer);
+
+		gbIf.getAllBooksByAuthor("google", "David A. Vise", 40, 20);
+
+		ASSERT_EQ(4u, tracer->spans.size());
+
+		const auto& search = *tracer->spans[0];
+		ASSERT_EQ("googlebooks.search", search.name);
+		ASSERT_EQ("", search.parent);
+		ASSERT_EQ("author", search.attributes.at("googlebooks.method"));
+		ASSERT_EQ("40", search.attributes.at("googlebooks.start_index"));
+		ASSERT_EQ("20", search.attributes.at("googlebooks.max_results"));
+		ASSERT_EQ("miss", search.attributes.at("googlebooks.cache"));
+
+		const char* children[]{ "googlebooks.queue", "googlebooks.transport", "googlebooks.parse" };
+		for (size_t i = 0; i < 3; ++i)
+		{
+			ASSERT_EQ(children[i], tracer->spans[i + 1]->name);
+			ASSERT_EQ("googlebooks.search", tracer->spans[i + 1]->parent);
+		}
+
+		ASSERT_EQ("200", tracer->spans[2]->attributes.at("http.response.status_code"));
+		ASSERT_EQ(to_string(NoBooksFound.size()), tracer->spans[3]->attributes.at("googlebooks.bytes"));
+
+		for (const auto& span : tracer->spans)
+			ASSERT_TRUE(span->ended);
+	}
+
+	TEST(TestTracing, CacheHitHasNoChildSpan)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		gbIf.getAllBooksByTerm("google");
+
+		auto tracer = make_shared<RecordingTracer>();
+		gbIf.setTracer(tracer);
+		gbIf.getAllBooksByTerm("google");
+
+		ASSERT_EQ(1u, tracer->spans.size());
+		ASSERT_EQ("hit", tracer->spans[0]->attributes.at("googlebooks.cache"));
+	}
+
+	TEST(TestTracing, FailureIsReportedOnTheSearchSpan)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+		auto tracer = make_shared<RecordingTracer>();
+		gbIf.setTracer(tracer);
+
+		ASSERT_THROW(gbIf.search(BooksQuery{}), GoogleBooksInterfaceException);
+		gbIf.getAllBooksByTerm("InvalidKey");
+
+		ASSERT_EQ("Query has neither a term nor a qualifier", tracer->spans[0]->error);
+		ASSERT_FALSE(tracer->spans[1]->error.empty());
+
+		gbIf.setTracer(nullptr);
+		gbIf.getAllBooksByTerm("untraced");
+		ASSERT_EQ(5u, tracer->spans.size());
+	}
+
+	TEST(TestConnectionStats, OpenConnectionsAreSplitIntoActiveAndIdle)
+	{
+		auto metrics = ClientMetrics{};
+
+		auto handshake = TransferTiming{};
+		handshake.transferred = true;
+		handshake.appConnect = chrono::milliseconds{ 40 };
+
+		auto reused = TransferTiming{};
+		reused.transferred = true;
+		reused.connectionReused = true;
+
+		metrics.transferStarted();
+		metrics.connectionOpened();
+		metrics.recordNameLookup(false);
+		metrics.transferFinished(handshake);
+
+		metrics.transferStarted();
+		metrics.connectionOpened();
+		metrics.recordNameLookup(true);
+		metrics.transferFinished(handshake);
+
+		metrics.transferStarted();
+		metrics.transferFinished(reused);
+
+		metrics.connectionOpened();
+		metrics.connectionClosed();
+		metrics.transferStarted();
+
+		const auto stats = metrics.connectionStats();
+		ASSERT_EQ(2u, stats.opened);
+		ASSERT_EQ(1u, stats.reused);
+		ASSERT_EQ(2u, stats.tlsHandshakes);
+		ASSERT_EQ(1u, stats.dnsLookups);
+		ASSERT_EQ(1u, stats.dnsCacheHits);
+		ASSERT_EQ(1, stats.active);
+		ASSERT_EQ(1, stats.idle);
+
+		const auto rendered = metrics.render();
+		ASSERT_TRUE(hasSample(rendered, "googlebooks_connections_opened_total 2"));
+		ASSERT_TRUE(hasSample(rendered, "googlebooks_tls_handshakes_total 2"));
+		ASSERT_TRUE(hasSample(rendered, R"(googlebooks_dns_lookups_total{result="cached"} 1)"));
+		ASSERT_TRUE(hasSample(rendered, R"(googlebooks_connections{state="idle"} 1)"));
+	}
+
+	TEST(TestFlightRecorder, KeepsTheMostRecentTransfers)
+	{
+		auto recorder = FlightRecorder{ 6 };
+		ASSERT_EQ(8u, recorder.capacity());
+
+		const auto now = chrono::system_clock::now();
+		for (auto i = 0; i < 20; ++i)
+			recorder.record("volumes?q=" + to_string(i), now, chrono::milliseconds{ i }, 200, {});
+		recorder.record("volumes?q=failed", now, chrono::milliseconds{ 1 }, 0, {}, string(100, 'x'));
+
+		const auto records = recorder.snapshot();
+		ASSERT_EQ(21u, recorder.recorded());
+		ASSERT_EQ(8u, records.size());
+
+		for (size_t i = 0; i < 7; ++i)
+		{
+			ASSERT_EQ(13 + i, records[i].sequence);
+			ASSERT_EQ(FlightRecorder::hashResource("volumes?q=" + to_string(13 + i)), records[i].resourceHash);
+			ASSERT_EQ(chrono::milliseconds{ 13 + static_cast<int>(i) }, records[i].elapsed);
+		}
+
+		ASSERT_EQ(0, records.back().status);
+		ASSERT_EQ(string(63, 'x'), records.back().error);
+	}
+
+	TEST(TestFlightRecorder, ConcurrentReadersNeverSeeTornRecords)
+	{
+		auto recorder = FlightRecorder{ 64 };
+		const auto now = chrono::system_clock::now();
+
+		vector<thread> writers;
+		for (auto w = 0; w < 4; ++w)
+		{
+			writers.emplace_back([&recorder, now, w] {
+				for (auto i = 0; i < 20000; ++i)
+				{
+					auto timing = TransferTiming{};
+					timing.bytesDownloaded = static_cast<uint64_t>(w * 100000 + i);
+					recorder.record("volumes?q=x", now, chrono::microseconds{ w * 100000 + i }, w * 100000 + i, timing);
+				}
+			});
+		}
+
+		auto torn = 0;
+		for (auto r = 0; r < 200; ++r)
+		{
+			for (const auto& record : recorder.snapshot())
+			{
+				if (record.elapsed.count() != record.status || record.timing.bytesDownloaded != static_cast<uint64_t>(record.status))
+					++torn;
+			}
+		}
+
+		for (auto& writer : writers)
+			writer.join();
+
+		ASSERT_EQ(0, torn);
+		ASSERT_EQ(80000u, recorder.recorded());
+		ASSERT_EQ(64u, recorder.snapshot().size());
+	}
+
+	TEST(TestFlightRecorder, InterfaceRecordsEveryTransfer)
+	{
+		auto gbIf = CountingGoogleBooksInterface{};
+
+		gbIf.getAllBooksByTerm("google");
+		gbIf.getAllBooksByTerm("InvalidKey");
+
+		const auto records = gbIf.flightRecorder().snapshot();
+		ASSERT_EQ(2u, records.size());
+		ASSERT_EQ(200, records[0].status);
+		ASSERT_EQ(NoBooksFound.size(), records[0].timing.bytesDownloaded);
+		ASSERT_EQ(400, records[1].status);
+		ASSERT_TRUE(records[1].timing.connectionReused);
+		ASSERT_NE(records[0].resourceHash, records[1].resourceHash);
+
+		auto file = tmpfile();
+		ASSERT_NE(nullptr, file);
+#ifdef _MSC_VER
+		gbIf.flightRecorder().dump(_fileno(file));
+#else
+		gbIf.flightRecorder().dump(fileno(file));
+#endif // _MSC_VER
+
+		rewind(file);
+		char line[512];
+		vector<string> lines;
+		while (fgets(line, sizeof(line), file))
+			lines.emplace_back(line);
+		fclose(file);
+
+		ASSERT_EQ(2u, lines.size());
+		ASSERT_EQ(0u, lines[1].find("#1 "));
+		ASSERT_NE(string::npos, lines[1].find(" status=400 "));
+		ASSERT_NE(string::npos, lines[1].find(" reused=1 "));
+		ASSERT_NE(string::npos, lines[0].find(" status=200 elapsed_us="));
+		ASSERT_NE(string::npos, lines[0].find(" bytes=" + to_string(NoBooksFound.size()) + " "));
+		ASSERT_EQ(string::npos, lines[0].find(" started=0."));
+		ASSERT_EQ('\n', lines[0].back());
+	}
+}
@@ -0,0 +1,347 @@
+#include "pch.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment (lib,"Ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <json/json.h>
+#include "MockGoogleBooksServer.h"
+
+using namespace std;
+
+namespace
+{
+#ifdef _WIN32
+	using Socket = SOCKET;
+	using SocketLength = int;
+	constexpr int sendFlags{ 0 };
+	constexpr int bothDirections{ SD_BOTH };
+
+	void closeSocket(Socket socket)
+	{
+		closesocket(socket);
+	}
+#else
+	using Socket = int;
+	using SocketLength = socklen_t;
+	constexpr int sendFlags{ MSG_NOSIGNAL };
+	constexpr int bothDirections{ SHUT_RDWR };
+
+	void closeSocket(Socket socket)
+	{
+		close(socket);
+	}
+#endif // _WIN32
+
+	// INVALID_SOCKET and -1 both convert to the highest value.
+	constexpr auto invalidSocket = static_cast<uintptr_t>(-1);
+
+	Socket native(uintptr_t socket)
+	{
+		return static_cast<Socket>(socket);
+	}
+
+	const char* reasonPhrase(long status)
+	{
+		switch (status)
+		{
+		case 200:
+			return "OK";
+		case 400:
+			return "Bad Request";
+		case 404:
+			return "Not Found";
+		case 429:
+			return "Too Many Requests";
+		case 500:
+			return "Internal Server Error";
+		case 503:
+			return "Service Unavailable";
+		default:
+			return "Mock Status";
+		}
+	}
+
+	string errorBody(long status, const string& message)
+	{
+		return R"({"error":{"code":)" + to_string(status) + R"(,"message":")" + message + R"("}})";
+	}
+
+	// Extracts a parameter of a request target, as sent.
+	string queryParameter(const string& target, const string& name)
+	{
+		for (const auto separator : { '?', '&' })
+		{
+			const auto key = separator + name + '=';
+			if (const auto start = target.find(key); start != string::npos)
+			{
+				const auto value = start + key.size();
+				return target.substr(value, target.find('&', value) - value);
+			}
+		}
+
+		return {};
+	}
+
+	string generatePage(size_t volumes, size_t descriptionSize)
+	{
+		Json::Value page{ Json::objectValue };
+		page["kind"] = "books#volumes";
+		page["totalItems"] = static_cast<Json::UInt64>(volumes);
+
+		for (size_t i = 0; i < volumes; ++i)
+		{
+			Json::Value volume{ Json::objectValue };
+			volume["kind"] = "books#volume";
+			volume["id"] = "mockVolume" + to_string(i);
+
+			auto& info = volume["volumeInfo"];
+			info["title"] = "Mock volume " + to_string(i + 1);
+			info["authors"].append("Mock Author");
+			if (descriptionSize > 0)
+				info["description"] = string(descriptionSize, 'x');
+
+			page["items"].append(volume);
+		}
+
+		Json::StreamWriterBuilder builder;
+		builder["indentation"] = "";
+
+		return Json::writeString(builder, page);
+	}
+
+	bool sendAll(Socket socket, const string& data)
+	{
+		size_t sent{ 0 };
+		while (sent < data.size())
+		{
+			const auto count = send(socket, data.data() + sent, static_cast<int>(data.size() - sent), sendFlags);
+			if (count <= 0)
+				return false;
+
+			sent += static_cast<size_t>(count);
+		}
+
+		return true;
+	}
+}
+
+MockGoogleBooksServer::MockGoogleBooksServer() : m_listener{ invalidSocket }, m_generatedPage{ generatePage(0, 0) }
+{
+#ifdef _WIN32
+	WSADATA data;
+	WSAStartup(MAKEWORD(2, 2), &data);
+#endif // _WIN32
+
+	const auto listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	m_listener = static_cast<uintptr_t>(listener);
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	SocketLength length{ sizeof(address) };
+
+	if (m_listener == invalidSocket
+		|| ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+		|| listen(listener, SOMAXCONN) != 0
+		|| getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+	{
+		if (m_listener != invalidSocket)
+			closeSocket(listener);
+#ifdef _WIN32
+		WSACleanup();
+#endif // _WIN32
+		throw runtime_error{ "Failed to listen on the loopback interface" };
+	}
+
+	m_port = ntohs(address.sin_port);
+	m_acceptor = thread{ [this] { acceptConnections(); } };
+}
+
+MockGoogleBooksServer::~MockGoogleBooksServer()
+{
+	m_stopping = true;
+
+	// Linux wakes a blocked accept() on shutdown, Windows only on close.
+	shutdown(native(m_listener), bothDirections);
+#ifdef _WIN32
+	closeSocket(native(m_listener));
+#endif // _WIN32
+	m_acceptor.join();
+#ifndef _WIN32
+	closeSocket(native(m_listener));
+#endif // _WIN32
+
+	vector<thread> workers;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		for (const auto client : m_clients)
+			shutdown(native(client), bothDirections);
+
+		workers.swap(m_workers);
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+
+#ifdef _WIN32
+	WSACleanup();
+#endif // _WIN32
+}
+
+string MockGoogleBooksServer::endpoint() const
+{
+	return "http://127.0.0.1:" + to_string(m_port) + "/books/v1/";
+}
+
+void MockGoogleBooksServer::record(const string& query, const string& body, long status)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_recorded[query] = { status, body };
+}
+
+void MockGoogleBooksServer::setGeneratedPage(size_t volumes, size_t descriptionSize)
+{
+	auto page = generatePage(volumes, descriptionSize);
+
+	lock_guard<mutex> lock(m_mutex);
+	m_generatedPage.swap(page);
+}
+
+void MockGoogleBooksServer::setLatency(chrono::milliseconds latency)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_latency = latency;
+}
+
+void MockGoogleBooksServer::stall(const string& query, chrono::milliseconds latency)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_stalled[query] = latency;
+}
+
+void MockGoogleBooksServer::injectErrors(unsigned every, long status)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_errorEvery = every;
+	m_errorStatus = status;
+}
+
+string MockGoogleBooksServer::lastTarget() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_lastTarget;
+}
+
+void MockGoogleBooksServer::acceptConnections()
+{
+	while (!m_stopping)
+	{
+		const auto client = static_cast<uintptr_t>(accept(native(m_listener), nullptr, nullptr));
+		if (client == invalidSocket)
+			continue;
+
+		++m_connections;
+
+		lock_guard<mutex> lock(m_mutex);
+		m_clients.push_back(client);
+		m_workers.emplace_back([this, client] { serveConnection(client); });
+	}
+}
+
+void MockGoogleBooksServer::serveConnection(uintptr_t client)
+{
+	const auto socket = native(client);
+	string received;
+	char chunk[4096];
+
+	for (;;)
+	{
+		auto headEnd = received.find("\r\n\r\n");
+		while (headEnd == string::npos)
+		{
+			const auto count = recv(socket, chunk, static_cast<int>(sizeof(chunk)), 0);
+			if (count <= 0)
+				break;
+
+			received.append(chunk, static_cast<size_t>(count));
+			headEnd = received.find("\r\n\r\n");
+		}
+
+		if (headEnd == string::npos)
+			break;
+
+		// Requests are GETs without a body: "GET <target> HTTP/1.1", then the headers.
+		const auto head = received.substr(0, headEnd);
+		received.erase(0, headEnd + 4);
+
+		const auto targetStart = head.find(' ');
+		const auto targetEnd = head.find(' ', targetStart + 1);
+		if (targetStart == string::npos || targetEnd == string::npos)
+			break;
+
+		const auto response = respond(head.substr(targetStart + 1, targetEnd - targetStart - 1));
+		if (response.status == 0)
+			break;
+
+		const auto message = "HTTP/1.1 " + to_string(response.status) + ' ' + reasonPhrase(response.status)
+			+ "\r\nContent-Type: application/json; charset=UTF-8\r\nContent-Length: " + to_string(response.body.size())
+			+ "\r\n\r\n" + response.body;
+
+		if (!sendAll(socket, message) || head.find("\r\nConnection: close") != string::npos)
+			break;
+	}
+
+	{
+		// Forgotten first, so that stopping the server never shuts a reused descriptor down.
+		lock_guard<mutex> lock(m_mutex);
+		m_clients.erase(find(m_clients.begin(), m_clients.end(), client));
+	}
+
+	closeSocket(socket);
+}
+
+MockGoogleBooksServer::Response MockGoogleBooksServer::respond(const string& target)
+{
+	const auto number = ++m_requests;
+	const string root{ "/books/v1/" };
+
+	unique_lock<mutex> lock(m_mutex);
+	m_lastTarget = target;
+	auto latency = m_latency;
+
+	Response response;
+	if (m_errorEvery != 0 && number % m_errorEvery == 0)
+		response = { m_errorStatus, m_errorStatus ? errorBody(m_errorStatus, "Injected error") : string{} };
+	else if (target.compare(0, root.size() + 8, root + "volumes?") == 0)
+	{
+		const auto query = queryParameter(target, "q");
+		const auto recorded = m_recorded.find(query);
+		response = recorded != m_recorded.end() ? recorded->second : Response{ 200, m_generatedPage };
+
+		if (const auto stalled = m_stalled.find(query); stalled != m_stalled.end())
+		{
+			latency += stalled->second;
+			m_stalled.erase(stalled);
+		}
+	}
+	else
+		response = { 404, errorBody(404, "The volume ID could not be found.") };
+
+	lock.unlock();
+
+	if (latency > chrono::milliseconds::zero())
+		this_thread::sleep_for(latency);
+
+	return response;
+}
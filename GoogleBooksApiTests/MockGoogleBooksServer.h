@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class MockGoogleBooksServer
+ * @brief Google Books API stand-in listening on the loopback interface.
+ *
+ * Point a GoogleBooksInterface at endpoint() to run it over real HTTP without the
+ * network: searches are answered with the response recorded for their q parameter,
+ * or with a generated page of configurable size, and volume lookups with not found.
+ * Latency and failures can be injected to exercise the transport reproducibly.
+ * Connections are kept alive and each one is served by its own thread.
+ */
+class MockGoogleBooksServer
+{
+public:
+	/**
+	 * @brief Starts listening on an ephemeral port of 127.0.0.1.
+	 * @throw std::runtime_error When the socket cannot be set up.
+	 */
+	MockGoogleBooksServer();
+
+	/**
+	 * @brief Closes every connection and stops listening.
+	 */
+	~MockGoogleBooksServer();
+
+	MockGoogleBooksServer(const MockGoogleBooksServer&) = delete;
+	MockGoogleBooksServer& operator=(const MockGoogleBooksServer&) = delete;
+
+	/**
+	 * @brief Retrieves the API root to hand to GoogleBooksInterface::setEndpoint().
+	 * @return The endpoint, e.g. "http://127.0.0.1:49152/books/v1/".
+	 */
+	std::string endpoint() const;
+
+	/**
+	 * @brief Records the response of a search.
+	 * @param query The q parameter of the search, as sent: percent-encoded, qualifiers included.
+	 * @param body The response body.
+	 * @param status The HTTP status code.
+	 */
+	void record(const std::string& query, const std::string& body, long status = 200);
+
+	/**
+	 * @brief Sets the page answering the searches with no recorded response.
+	 * @param volumes The number of volumes in the page.
+	 * @param descriptionSize The length of the description of each volume, to grow the page.
+	 */
+	void setGeneratedPage(size_t volumes, size_t descriptionSize = 0);
+
+	/**
+	 * @brief Delays every response.
+	 * @param latency The time to wait before responding.
+	 */
+	void setLatency(std::chrono::milliseconds latency);
+
+	/**
+	 * @brief Delays the next request of a search only, on top of the latency of every response.
+	 *
+	 * Whichever request of the search arrives first is delayed, so that a hedge or a retry
+	 * of it is answered at once.
+	 * @param query The q parameter of the search, as sent.
+	 * @param latency The additional time to wait before responding.
+	 */
+	void stall(const std::string& query, std::chrono::milliseconds latency);
+
+	/**
+	 * @brief Makes every nth request fail.
+	 * @param every The period of the failures, 0 for none.
+	 * @param status The status of the failures, 0 to close the connection without responding.
+	 */
+	void injectErrors(unsigned every, long status = 503);
+
+	/**
+	 * @brief Retrieves the number of requests received.
+	 * @return The number of requests, failed ones included.
+	 */
+	size_t requests() const { return m_requests.load(); }
+
+	/**
+	 * @brief Retrieves the number of connections accepted.
+	 * @return The number of connections.
+	 */
+	size_t connections() const { return m_connections.load(); }
+
+	/**
+	 * @brief Retrieves the request target of the last request.
+	 * @return The path and query, e.g. "/books/v1/volumes?q=term&key=...".
+	 */
+	std::string lastTarget() const;
+
+private:
+	/**
+	 * @struct Response
+	 * @brief What the server answers to a request.
+	 */
+	struct Response
+	{
+		long status{ 200 }; ///< The HTTP status code, 0 to close the connection instead.
+		std::string body; ///< The response body.
+	};
+
+	std::uintptr_t m_listener; ///< The listening socket.
+	unsigned short m_port{ 0 }; ///< The port listened on.
+	std::thread m_acceptor; ///< Accepts connections until the server stops.
+	std::atomic<bool> m_stopping{ false }; ///< Set when the server stops.
+	std::atomic<size_t> m_requests{ 0 }; ///< Requests received.
+	std::atomic<size_t> m_connections{ 0 }; ///< Connections accepted.
+
+	mutable std::mutex m_mutex; ///< Guards the members below.
+	std::vector<std::uintptr_t> m_clients; ///< Sockets of the open connections.
+	std::vector<std::thread> m_workers; ///< Threads serving the connections.
+	std::unordered_map<std::string, Response> m_recorded; ///< Responses by q parameter.
+	std::string m_generatedPage; ///< Body answering the other searches.
+	std::chrono::milliseconds m_latency{ 0 }; ///< Delay before each response.
+	std::unordered_map<std::string, std::chrono::milliseconds> m_stalled; ///< Additional delay of the next request by q parameter.
+	unsigned m_errorEvery{ 0 }; ///< Period of the injected failures, 0 for none.
+	long m_errorStatus{ 503 }; ///< Status of the injected failures.
+	std::string m_lastTarget; ///< Request target of the last request.
+
+	/**
+	 * @brief Accepts connections and starts a thread serving each one.
+	 */
+	void acceptConnections();
+
+	/**
+	 * @brief Serves the requests of a connection until either side closes it.
+	 * @param client The socket of the connection.
+	 */
+	void serveConnection(std::uintptr_t client);
+
+	/**
+	 * @brief Chooses the response to a request.
+	 * @param target The request target.
+	 * @return The response, with a zero status when the connection must be closed instead.
+	 */
+	Response respond(const std::string& target);
+};
@@ -0,0 +1,188 @@
+#include "pch.h"
+
+#include <cctype>
+#include <cstdio>
+#include <vector>
+
+#include <json/json.h>
+#include "GoogleBooksInterface.h"
+#include "UrlEncoder.h"
+#include "UrlTemplate.h"
+
+namespace QueryScenarios
+{
+	using namespace std;
+
+	const string NoBooksFound = R"({"kind":"books#volumes","totalItems":0})";
+
+	class RecordingGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		vector<string> resources;
+
+		HttpResponse httpRequest(const HttpRequest& request) override
+		{
+			resources.emplace_back(request.resource);
+			return { 200, NoBooksFound };
+		}
+	};
+
+	// Runs a search of another interface on the calling thread before answering, as a decorator may.
+	class ReentrantGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		RecordingGoogleBooksInterface inner;
+		vector<string> resources;
+
+		HttpResponse httpRequest(const HttpRequest& request) override
+		{
+			inner.getAllBooksByIsbn("9788599296493");
+			resources.emplace_back(request.resource);
+			return { 200, NoBooksFound };
+		}
+	};
+
+	TEST(TestQueries, CompoundQueryIsOneRequest)
+	{
+		auto gbIf = RecordingGoogleBooksInterface{};
+
+		gbIf.search(BooksQuery{}
+			.inAuthor("Follett")
+			.subject("fiction")
+			.filter(BooksQuery::Filter::Ebooks)
+			.orderBy(BooksQuery::OrderBy::Newest)
+			.langRestrict("pt")
+			.printType(BooksQuery::PrintType::Books)
+			.maxResults(20));
+
+		ASSERT_EQ(1u, gbIf.resources.size());
+		ASSERT_EQ("volumes?q=inauthor:Follett+subject:fiction&filter=ebooks&orderBy=newest&langRestrict=pt&printType=books&maxResults=20"s,
+			gbIf.resources.front());
+	}
+
+	TEST(TestQueries, SingleQualifierMethodsUseTheBuilder)
+	{
+		auto gbIf = RecordingGoogleBooksInterface{};
+
+		gbIf.getAllBooksByAuthor("terra", "Follett", 40, 10);
+		gbIf.getAllBooksByIsbn("9788599296493", 10, 5);
+
+		ASSERT_EQ("volumes?q=terra+inauthor:Follett&startIndex=40&maxResults=10"s, gbIf.resources[0]);
+		ASSERT_EQ("volumes?q=isbn:9788599296493&startIndex=10&maxResults=5"s, gbIf.resources[1]);
+	}
+
+	TEST(TestQueries, SearchFromATransportHookLeavesTheOuterRequestIntact)
+	{
+		auto gbIf = ReentrantGoogleBooksInterface{};
+
+		gbIf.getAllBooksByAuthor("terra", "Follett", 40, 10);
+		gbIf.getVolumeById("zyTCAlFPjgYC");
+
+		ASSERT_EQ("volumes?q=terra+inauthor:Follett&startIndex=40&maxResults=10"s, gbIf.resources[0]);
+		ASSERT_EQ("volumes/zyTCAlFPjgYC"s, gbIf.resources[1]);
+		ASSERT_EQ("volumes?q=isbn:9788599296493&startIndex=0&maxResults=40"s, gbIf.inner.resources[0]);
+	}
+
+	TEST(TestQueries, EmptyQueryIsRejected)
+	{
+		auto gbIf = RecordingGoogleBooksInterface{};
+
+		ASSERT_THROW(gbIf.search(BooksQuery{}.langRestrict("pt")), GoogleBooksInterfaceException);
+		ASSERT_TRUE(gbIf.resources.empty());
+	}
+
+	TEST(TestQueries, ReservedCharactersArePercentEncoded)
+	{
+		auto gbIf = RecordingGoogleBooksInterface{};
+
+		gbIf.search(BooksQuery{}.term("Tom & Jerry").inTitle("C++ #1"));
+
+		ASSERT_EQ("volumes?q=Tom%20%26%20Jerry+intitle:C%2B%2B%20%231"s, gbIf.resources.front());
+	}
+
+	TEST(TestUrlEncoder, UnreservedCharactersAreCopied)
+	{
+		ASSERT_EQ("AZaz09-._~"s, UrlEncoder::encode("AZaz09-._~"));
+		ASSERT_EQ(""s, UrlEncoder::encode(""));
+	}
+
+	TEST(TestUrlEncoder, Utf8BytesAreEncodedOneByOne)
+	{
+		ASSERT_EQ("Jos%C3%A9%20Saramago"s, UrlEncoder::encode(u8"Jos\u00e9 Saramago"));
+		ASSERT_EQ("%00%7F%80%FF"s, UrlEncoder::encode("\x00\x7F\x80\xFF"s));
+	}
+
+	string referenceEncode(const string& input)
+	{
+		string expected;
+		for (auto c : input)
+		{
+			const auto byte = static_cast<unsigned char>(c);
+			if ((byte < 0x80 && isalnum(byte)) || c == '-' || c == '.' || c == '_' || c == '~')
+				expected += c;
+			else
+			{
+				char encoded[4];
+				snprintf(encoded, sizeof(encoded), "%%%02X", byte);
+				expected += encoded;
+			}
+		}
+		return expected;
+	}
+
+	TEST(TestUrlEncoder, EveryByteMatchesTheScalarDefinitionAtEveryOffset)
+	{
+		string bytes;
+		for (auto i = 0; i < 256; ++i)
+			bytes += static_cast<char>(i);
+
+		// Long unreserved runs between reserved bytes make the vector path stop at every lane.
+		string runs;
+		for (auto i = 0; i < 256; ++i)
+			runs += string(i % 37, 'k') + static_cast<char>(i);
+
+		for (const auto& input : { bytes, runs })
+		{
+			for (size_t offset = 0; offset < 16; ++offset)
+			{
+				const auto suffix = input.substr(offset);
+				ASSERT_EQ(referenceEncode(suffix), UrlEncoder::encode(suffix));
+			}
+		}
+	}
+
+	TEST(TestUrlTemplate, ResourceIsSplicedBetweenEndpointAndKey)
+	{
+		auto urlTemplate = UrlTemplate{};
+		string url;
+
+		urlTemplate.expand("volumes?q=isbn:9780553804577", url);
+		ASSERT_EQ("https://www.googleapis.com/books/v1/volumes?q=isbn:9780553804577"s, url);
+
+		urlTemplate.setApiKey("a key&more");
+		urlTemplate.expand("volumes?q=isbn:9780553804577", url);
+		ASSERT_EQ("https://www.googleapis.com/books/v1/volumes?q=isbn:9780553804577&key=a%20key%26more"s, url);
+
+		urlTemplate.expand("volumes/zyTCAlFPjgYC", url);
+		ASSERT_EQ("https://www.googleapis.com/books/v1/volumes/zyTCAlFPjgYC?key=a%20key%26more"s, url);
+	}
+
+	TEST(TestUrlTemplate, EndpointIsNormalized)
+	{
+		auto urlTemplate = UrlTemplate{};
+
+		ASSERT_TRUE(urlTemplate.setEndpoint("http://127.0.0.1:8080/books/v1?debug=1#top"));
+		ASSERT_EQ("http://127.0.0.1:8080/books/v1/"s, urlTemplate.endpoint());
+
+		ASSERT_FALSE(urlTemplate.setEndpoint("not an absolute url"));
+		ASSERT_EQ("http://127.0.0.1:8080/books/v1/"s, urlTemplate.endpoint());
+	}
+
+	TEST(TestUrlTemplate, InvalidEndpointIsRejected)
+	{
+		auto gbIf = RecordingGoogleBooksInterface{};
+
+		ASSERT_THROW(gbIf.setEndpoint("not an absolute url"), GoogleBooksInterfaceException);
+		ASSERT_NO_THROW(gbIf.setEndpoint("http://localhost:8080/"));
+	}
+}
@@ -0,0 +1,650 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+#include "GoogleBooksInterface.h"
+
+namespace ResilienceScenarios
+{
+	using namespace std;
+
+	const string NoBooksFound = R"({"kind":"books#volumes","totalItems":0})";
+
+	class CountingGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		int requests{ 0 };
+
+		HttpResponse httpRequest(const HttpRequest&) override
+		{
+			++requests;
+			return { 200, NoBooksFound };
+		}
+	};
+
+	const string ServiceUnavailable = R"({"error":{"code":503,"message":"The service is currently unavailable."}})";
+
+	// Replays a script of responses; a status of 0 stands for a transient transport failure.
+	class ScriptedGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		vector<HttpResponse> script;
+		size_t requests{ 0 };
+
+		ScriptedGoogleBooksInterface(vector<HttpResponse> responses) : script{ move(responses) }
+		{
+			setRetryPolicy({ 3, chrono::milliseconds{ 1 }, chrono::milliseconds{ 1000 } });
+		}
+
+		HttpResponse httpRequest(const HttpRequest&) override
+		{
+			const auto& response = script[min(requests++, script.size() - 1)];
+
+			if (response.status == 0)
+				throw GoogleBooksTransportException{ "Failed to get data from URL", true };
+
+			return response;
+		}
+	};
+
+	// Blocks its first transfer until the caller cancels it, as the transport does; later transfers succeed.
+	class StallingGoogleBooksInterface : public GoogleBooksInterface
+	{
+	public:
+		atomic<int> requests{ 0 };
+
+		HttpResponse httpRequest(const HttpRequest& request) override
+		{
+			if (requests++ > 0)
+				return { 200, NoBooksFound };
+
+			while (!request.cancellation.cancelled() && chrono::steady_clock::now() < request.deadline)
+				this_thread::sleep_for(chrono::milliseconds{ 1 });
+
+			throw GoogleBooksCancelledException{ "Request cancelled", false };
+		}
+	};
+
+	// Refills the process-wide retry budget before and after a test.
+	struct SharedRetryBudgetGuard
+	{
+		SharedRetryBudgetGuard()
+		{
+			RetryBudget::shared().configure(0.1, 10);
+		}
+
+		~SharedRetryBudgetGuard()
+		{
+			RetryBudget::shared().configure(0.1, 10);
+		}
+	};
+
+	// Restores the process-wide rate limit when a test ends, even on failure.
+	struct SharedRateLimitGuard
+	{
+		~SharedRateLimitGuard()
+		{
+			RateLimiter::shared().setPolicy({});
+		}
+	};
+
+	// Restores the process-wide concurrency window when a test ends, even on failure.
+	struct SharedConcurrencyGuard
+	{
+		~SharedConcurrencyGuard()
+		{
+			ConcurrencyLimiter::shared().setPolicy({});
+		}
+	};
+
+	TEST(TestRateLimiter, BurstIsServedThenFailsFast)
+	{
+		auto limiter = RateLimiter{ { 0.001, 3, RateLimitMode::FailFast } };
+
+		ASSERT_TRUE(limiter.acquire());
+		ASSERT_TRUE(limiter.acquire());
+		ASSERT_TRUE(limiter.acquire());
+		ASSERT_FALSE(limiter.acquire());
+	}
+
+	TEST(TestRateLimiter, QueuedRequestsAreSpacedAtTheSustainedRate)
+	{
+		auto limiter = RateLimiter{ { 50, 1, RateLimitMode::Queue } };
+
+		const auto start = chrono::steady_clock::now();
+		for (auto i = 0; i < 5; ++i)
+			ASSERT_TRUE(limiter.acquire());
+
+		ASSERT_GE(chrono::steady_clock::now() - start, chrono::milliseconds{ 75 });
+	}
+
+	TEST(TestRateLimiter, QueuedRequestFailsBeyondMaxWait)
+	{
+		auto limiter = RateLimiter{ { 0.001, 1, RateLimitMode::Queue, chrono::milliseconds{ 100 } } };
+
+		ASSERT_TRUE(limiter.acquire());
+
+		const auto start = chrono::steady_clock::now();
+		ASSERT_FALSE(limiter.acquire());
+		ASSERT_LT(chrono::steady_clock::now() - start, chrono::milliseconds{ 100 });
+	}
+
+	TEST(TestRateLimiter, SharedLimiterThrottlesEveryInstance)
+	{
+		SharedRateLimitGuard guard;
+		RateLimiter::shared().setPolicy({ 0.001, 2, RateLimitMode::FailFast });
+
+		auto first = CountingGoogleBooksInterface{};
+		auto second = CountingGoogleBooksInterface{};
+
+		first.getAllBooksByTerm("first");
+		second.getAllBooksByTerm("second");
+
+		try
+		{
+			first.getAllBooksByTerm("third");
+			FAIL() << "Expected GoogleBooksInterfaceException";
+		}
+		catch (const GoogleBooksInterfaceException& e)
+		{
+			ASSERT_STREQ("Rate limit exceeded", e.what());
+		}
+
+		ASSERT_EQ(1, first.requests);
+		ASSERT_EQ(1, second.requests);
+	}
+
+	TEST(TestConcurrencyLimiter, WindowGrowsAdditivelyWhileLatencyIsStable)
+	{
+		auto limiter = ConcurrencyLimiter{ { 4, 1, 64 } };
+
+		for (auto i = 0; i < 4; ++i)
+		{
+			limiter.acquire();
+			limiter.release(200, chrono::milliseconds{ 10 });
+		}
+
+		ASSERT_GT(limiter.limit(), 4.5);
+		ASSERT_LT(limiter.limit(), 5.0);
+	}
+
+	TEST(TestConcurrencyLimiter, WindowIsCutOnceForABurstOfThrottledResponses)
+	{
+		auto limiter = ConcurrencyLimiter{ { 8, 1, 64 } };
+
+		limiter.acquire();
+		limiter.acquire();
+		limiter.release(429, chrono::milliseconds{ 200 });
+		ASSERT_DOUBLE_EQ(4.0, limiter.limit());
+
+		limiter.release(503, chrono::milliseconds{ 200 });
+		ASSERT_DOUBLE_EQ(4.0, limiter.limit());
+	}
+
+	TEST(TestConcurrencyLimiter, LatencySpikeCutsTheWindow)
+	{
+		auto limiter = ConcurrencyLimiter{ { 8, 1, 8 } };
+
+		for (auto i = 0; i < 5; ++i)
+		{
+			limiter.acquire();
+			limiter.release(200, chrono::milliseconds{ 10 });
+		}
+		ASSERT_DOUBLE_EQ(8.0, limiter.limit());
+
+		limiter.acquire();
+		limiter.release(200, chrono::milliseconds{ 100 });
+		ASSERT_DOUBLE_EQ(4.0, limiter.limit());
+	}
+
+	TEST(TestConcurrencyLimiter, TransferWaitsForAFreeSlot)
+	{
+		auto limiter = ConcurrencyLimiter{ { 1, 1, 1 } };
+
+		auto permit = make_unique<ConcurrencyLimiter::Permit>(limiter);
+		auto second = async(launch::async, [&limiter] { ConcurrencyLimiter::Permit permit{ limiter }; });
+
+		ASSERT_EQ(future_status::timeout, second.wait_for(chrono::milliseconds{ 50 }));
+
+		permit.reset();
+		ASSERT_EQ(future_status::ready, second.wait_for(chrono::seconds{ 5 }));
+		ASSERT_EQ(0u, limiter.inFlight());
+	}
+
+	TEST(TestRetries, TransientStatusIsRetriedUntilSuccess)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 503, ServiceUnavailable }, { 502, {} }, { 200, NoBooksFound } } };
+
+		const auto books = gbIf.getAllBooksByTerm("retried");
+
+		ASSERT_EQ(0, books["totalItems"].asInt());
+		ASSERT_EQ(3u, gbIf.requests);
+	}
+
+	TEST(TestRetries, ClientErrorIsNotRetried)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 400, R"({"error":{"code":400}})" }, { 200, NoBooksFound } } };
+
+		gbIf.getAllBooksByTerm("rejected");
+
+		ASSERT_EQ(1u, gbIf.requests);
+	}
+
+	TEST(TestRetries, TransientTransportFailureIsRetried)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 0, {} }, { 200, NoBooksFound } } };
+
+		ASSERT_NO_THROW(gbIf.getAllBooksByTerm("reset"));
+		ASSERT_EQ(2u, gbIf.requests);
+	}
+
+	TEST(TestRetries, ExhaustedTransportRetriesRethrowTheFailure)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 0, {} } } };
+
+		ASSERT_THROW(gbIf.getAllBooksByTerm("unreachable"), GoogleBooksTransportException);
+		ASSERT_EQ(3u, gbIf.requests);
+	}
+
+	TEST(TestRetries, RetryAfterIsHonored)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 429, {}, {}, chrono::milliseconds{ 60 } }, { 200, NoBooksFound } } };
+
+		const auto start = chrono::steady_clock::now();
+		gbIf.getAllBooksByTerm("throttled");
+
+		ASSERT_GE(chrono::steady_clock::now() - start, chrono::milliseconds{ 60 });
+		ASSERT_EQ(2u, gbIf.requests);
+	}
+
+	TEST(TestRetries, RetryAfterBeyondMaxDelayGivesUp)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 429, {}, {}, chrono::seconds{ 60 } }, { 200, NoBooksFound } } };
+
+		gbIf.getAllBooksByTerm("throttled");
+
+		ASSERT_EQ(1u, gbIf.requests);
+	}
+
+	TEST(TestRetries, EmptyBudgetPreventsRetries)
+	{
+		SharedRetryBudgetGuard guard;
+		RetryBudget::shared().configure(0.1, 0);
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 503, ServiceUnavailable }, { 200, NoBooksFound } } };
+
+		gbIf.getAllBooksByTerm("storm");
+
+		ASSERT_EQ(1u, gbIf.requests);
+	}
+
+	TEST(TestRetries, BudgetAllowsARatioOfTheRequests)
+	{
+		auto budget = RetryBudget{ 0.5, 2 };
+
+		ASSERT_TRUE(budget.tryWithdraw());
+		ASSERT_TRUE(budget.tryWithdraw());
+		ASSERT_FALSE(budget.tryWithdraw());
+
+		budget.recordRequest();
+		ASSERT_FALSE(budget.tryWithdraw());
+		budget.recordRequest();
+		ASSERT_TRUE(budget.tryWithdraw());
+	}
+
+	TEST(TestRetries, BackoffIsJitteredBelowTheExponentialCeiling)
+	{
+		const auto policy = RetryPolicy{ 5, chrono::milliseconds{ 100 }, chrono::milliseconds{ 1000 } };
+
+		for (auto i = 0; i < 100; ++i)
+		{
+			ASSERT_LE(policy.backoff(1, {}).count(), 100);
+			ASSERT_LE(policy.backoff(4, {}).count(), 800);
+			ASSERT_LE(policy.backoff(10, {}).count(), 1000);
+			ASSERT_GE(policy.backoff(10, {}).count(), 0);
+		}
+	}
+
+	TEST(TestCircuitBreaker, OpensAtTheFailureRateOnceTheWindowHoldsEnoughRequests)
+	{
+		auto breaker = CircuitBreaker{ { true, 0.5, 4, 10 } };
+
+		for (auto success : { true, false, false })
+		{
+			ASSERT_TRUE(breaker.allow());
+			breaker.record(success);
+		}
+		ASSERT_EQ(CircuitBreaker::State::Closed, breaker.state());
+
+		ASSERT_TRUE(breaker.allow());
+		breaker.record(true);
+		ASSERT_EQ(CircuitBreaker::State::Open, breaker.state());
+		ASSERT_FALSE(breaker.allow());
+	}
+
+	TEST(TestCircuitBreaker, SuccessfulProbesCloseTheCircuit)
+	{
+		auto breaker = CircuitBreaker{ { true, 0.5, 1, 10, chrono::milliseconds{ 20 }, 2 } };
+
+		breaker.allow();
+		breaker.record(false);
+		this_thread::sleep_for(chrono::milliseconds{ 30 });
+
+		ASSERT_EQ(CircuitBreaker::State::HalfOpen, breaker.state());
+		ASSERT_TRUE(breaker.allow());
+		ASSERT_TRUE(breaker.allow());
+		ASSERT_FALSE(breaker.allow());
+
+		breaker.record(true);
+		breaker.record(true);
+		ASSERT_EQ(CircuitBreaker::State::Closed, breaker.state());
+	}
+
+	TEST(TestCircuitBreaker, FailedProbeReopensTheCircuit)
+	{
+		auto breaker = CircuitBreaker{ { true, 0.5, 1, 10, chrono::milliseconds{ 20 }, 2 } };
+
+		breaker.allow();
+		breaker.record(false);
+		this_thread::sleep_for(chrono::milliseconds{ 30 });
+
+		ASSERT_TRUE(breaker.allow());
+		breaker.abandon();
+		ASSERT_TRUE(breaker.allow());
+		ASSERT_TRUE(breaker.allow());
+
+		breaker.record(false);
+		ASSERT_EQ(CircuitBreaker::State::Open, breaker.state());
+	}
+
+	TEST(TestCircuitBreaker, OpenCircuitFailsFastWithoutTheTransport)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 503, ServiceUnavailable } } };
+		gbIf.setRetryPolicy({ 1 });
+		gbIf.setCircuitBreakerPolicy({ true, 0.5, 3, 10, chrono::minutes{ 1 }, 1, CircuitFallback::FailFast });
+
+		for (auto i = 0; i < 3; ++i)
+			gbIf.getAllBooksByTerm("outage");
+
+		ASSERT_THROW(gbIf.getAllBooksByTerm("outage"), GoogleBooksCircuitOpenException);
+		ASSERT_EQ(3u, gbIf.requests);
+	}
+
+	TEST(TestCircuitBreaker, OpenCircuitServesTheCachedResponse)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 200, R"({"kind":"books#volumes","totalItems":7})", { "\"v1\"" } }, { 503, ServiceUnavailable } } };
+		gbIf.setRetryPolicy({ 1 });
+		gbIf.setCachePolicy({ chrono::milliseconds{ 1 }, chrono::milliseconds{ 1 }, 1000, chrono::milliseconds{ 0 } });
+		gbIf.setCircuitBreakerPolicy({ true, 0.6, 2, 10, chrono::minutes{ 1 } });
+
+		gbIf.getAllBooksByTerm("cached");
+		gbIf.getAllBooksByTerm("uncached");
+		gbIf.getAllBooksByTerm("uncached");
+		this_thread::sleep_for(chrono::milliseconds{ 5 });
+
+		ASSERT_EQ(7, gbIf.getAllBooksByTerm("cached")["totalItems"].asInt());
+		ASSERT_THROW(gbIf.getAllBooksByTerm("uncached"), GoogleBooksCircuitOpenException);
+		ASSERT_EQ(3u, gbIf.requests);
+	}
+
+	TEST(TestCircuitBreaker, OpenCircuitServesACachedResponsePastItsGracePeriod)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 200, R"({"kind":"books#volumes","totalItems":7})" }, { 503, ServiceUnavailable } } };
+		gbIf.setRetryPolicy({ 1 });
+		gbIf.setCachePolicy({ chrono::milliseconds{ 1 }, chrono::milliseconds{ 1 }, 1000, chrono::milliseconds{ 1 } });
+		gbIf.setCircuitBreakerPolicy({ true, 0.6, 2, 10, chrono::minutes{ 1 } });
+
+		gbIf.getAllBooksByTerm("cached");
+		this_thread::sleep_for(chrono::milliseconds{ 5 });
+		gbIf.getAllBooksByTerm("uncached");
+		gbIf.getAllBooksByTerm("uncached");
+
+		// Without validators the entry can no longer be revalidated, yet it is all there is.
+		ASSERT_EQ(7, gbIf.getAllBooksByTerm("cached")["totalItems"].asInt());
+		ASSERT_EQ(3u, gbIf.requests);
+	}
+
+	TEST(TestDeadlines, ExpiredDeadlineFailsWithoutTransfer)
+	{
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 200, NoBooksFound } } };
+
+		auto options = SearchOptions{};
+		options.deadline = chrono::steady_clock::now();
+
+		try
+		{
+			gbIf.getAllBooksByTerm("late", options);
+			FAIL() << "Expected GoogleBooksCancelledException";
+		}
+		catch (const GoogleBooksCancelledException& e)
+		{
+			ASSERT_TRUE(e.deadlineExceeded());
+		}
+
+		ASSERT_EQ(0u, gbIf.requests);
+	}
+
+	TEST(TestDeadlines, CancelledCallFailsWithoutTransfer)
+	{
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 200, NoBooksFound } } };
+		auto source = CancellationSource{};
+		source.cancel();
+
+		auto options = SearchOptions{};
+		options.cancellation = source.token();
+
+		try
+		{
+			gbIf.getAllBooksByTerm("gone", options);
+			FAIL() << "Expected GoogleBooksCancelledException";
+		}
+		catch (const GoogleBooksCancelledException& e)
+		{
+			ASSERT_FALSE(e.deadlineExceeded());
+		}
+
+		ASSERT_EQ(0u, gbIf.requests);
+	}
+
+	TEST(TestDeadlines, LaterCallsWithoutOptionsAreUnbounded)
+	{
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 200, NoBooksFound } } };
+
+		auto options = SearchOptions{};
+		options.deadline = chrono::steady_clock::now();
+		ASSERT_THROW(gbIf.getAllBooksByTerm("late", options), GoogleBooksCancelledException);
+
+		ASSERT_NO_THROW(gbIf.getAllBooksByTerm("late"));
+		ASSERT_EQ(1u, gbIf.requests);
+	}
+
+	TEST(TestDeadlines, NoRetryIsScheduledPastTheDeadline)
+	{
+		SharedRetryBudgetGuard guard;
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 503, ServiceUnavailable, {}, chrono::milliseconds{ 500 } }, { 200, NoBooksFound } } };
+
+		auto options = SearchOptions{};
+		options.deadline = chrono::steady_clock::now() + chrono::milliseconds{ 100 };
+
+		const auto start = chrono::steady_clock::now();
+		gbIf.getAllBooksByTerm("unavailable", options);
+
+		ASSERT_LT(chrono::steady_clock::now() - start, chrono::milliseconds{ 500 });
+		ASSERT_EQ(1u, gbIf.requests);
+	}
+
+	TEST(TestDeadlines, JoinedCallerStopsWaitingAtItsDeadline)
+	{
+		auto gbIf = StallingGoogleBooksInterface{};
+		auto source = CancellationSource{};
+
+		auto leaderOptions = SearchOptions{};
+		leaderOptions.cancellation = source.token();
+		auto leader = async(launch::async, [&] { return gbIf.getAllBooksByTerm("stalled", leaderOptions); });
+
+		while (gbIf.requests == 0)
+			this_thread::sleep_for(chrono::milliseconds{ 1 });
+
+		auto options = SearchOptions{};
+		options.deadline = chrono::steady_clock::now() + chrono::milliseconds{ 50 };
+		ASSERT_THROW(gbIf.getAllBooksByTerm("stalled", options), GoogleBooksCancelledException);
+
+		source.cancel();
+		ASSERT_THROW(leader.get(), GoogleBooksCancelledException);
+		ASSERT_EQ(1, gbIf.requests);
+	}
+
+	TEST(TestDeadlines, JoinedCallerStopsWaitingOnceCancelled)
+	{
+		auto gbIf = StallingGoogleBooksInterface{};
+		auto leaderSource = CancellationSource{};
+
+		auto leaderOptions = SearchOptions{};
+		leaderOptions.cancellation = leaderSource.token();
+		auto leader = async(launch::async, [&] { return gbIf.getAllBooksByTerm("stalled", leaderOptions); });
+
+		while (gbIf.requests == 0)
+			this_thread::sleep_for(chrono::milliseconds{ 1 });
+
+		auto source = CancellationSource{};
+		auto options = SearchOptions{};
+		options.cancellation = source.token();
+		auto joined = async(launch::async, [&] { return gbIf.getAllBooksByTerm("stalled", options); });
+
+		this_thread::sleep_for(chrono::milliseconds{ 20 });
+		source.cancel();
+
+		ASSERT_EQ(future_status::ready, joined.wait_for(chrono::seconds{ 1 }));
+		ASSERT_THROW(joined.get(), GoogleBooksCancelledException);
+
+		leaderSource.cancel();
+		ASSERT_THROW(leader.get(), GoogleBooksCancelledException);
+		ASSERT_EQ(1, gbIf.requests);
+	}
+
+	TEST(TestDeadlines, CallerStopsWaitingForATransferSlotAtItsDeadline)
+	{
+		SharedConcurrencyGuard guard;
+		ConcurrencyLimiter::shared().setPolicy({ 1, 1, 1 });
+		ConcurrencyLimiter::Permit busy{ ConcurrencyLimiter::shared() };
+
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 200, NoBooksFound } } };
+		auto options = SearchOptions{};
+		options.deadline = chrono::steady_clock::now() + chrono::milliseconds{ 50 };
+
+		try
+		{
+			gbIf.getAllBooksByTerm("queued", options);
+			FAIL() << "Expected GoogleBooksCancelledException";
+		}
+		catch (const GoogleBooksCancelledException& e)
+		{
+			ASSERT_TRUE(e.deadlineExceeded());
+		}
+
+		ASSERT_EQ(0u, gbIf.requests);
+		ASSERT_EQ(1u, ConcurrencyLimiter::shared().inFlight());
+	}
+
+	TEST(TestDeadlines, CancelledCallerStopsWaitingForATransferSlot)
+	{
+		SharedConcurrencyGuard guard;
+		ConcurrencyLimiter::shared().setPolicy({ 1, 1, 1 });
+		ConcurrencyLimiter::Permit busy{ ConcurrencyLimiter::shared() };
+
+		auto gbIf = ScriptedGoogleBooksInterface{ { { 200, NoBooksFound } } };
+		auto source = CancellationSource{};
+		auto options = SearchOptions{};
+		options.cancellation = source.token();
+
+		auto queued = async(launch::async, [&] { return gbIf.getAllBooksByTerm("queued", options); });
+		ASSERT_EQ(future_status::timeout, queued.wait_for(chrono::milliseconds{ 20 }));
+
+		source.cancel();
+		ASSERT_EQ(future_status::ready, queued.wait_for(chrono::seconds{ 5 }));
+		ASSERT_THROW(queued.get(), GoogleBooksCancelledException);
+		ASSERT_EQ(0u, gbIf.requests);
+	}
+
+	TEST(TestDeadlines, JoinedCallerFetchesAgainWhenTheSharedFetchIsCancelled)
+	{
+		auto gbIf = StallingGoogleBooksInterface{};
+		auto source = CancellationSource{};
+
+		auto leaderOptions = SearchOptions{};
+		leaderOptions.cancellation = source.token();
+		auto leader = async(launch::async, [&] { return gbIf.getAllBooksByTerm("abandoned", leaderOptions); });
+
+		while (gbIf.requests == 0)
+			this_thread::sleep_for(chrono::milliseconds{ 1 });
+
+		auto follower = async(launch::async, [&] { return gbIf.getAllBooksByTerm("abandoned"); });
+		this_thread::sleep_for(chrono::milliseconds{ 20 });
+		source.cancel();
+
+		ASSERT_THROW(leader.get(), GoogleBooksCancelledException);
+		ASSERT_EQ(0, follower.get()["totalItems"].asInt());
+		ASSERT_EQ(2, gbIf.requests);
+	}
+
+	TEST(TestHedging, NoHedgeUntilEnoughLatenciesAreKnown)
+	{
+		auto hedging = HedgeController{ { true, 0.9, 0.05, 10 } };
+
+		for (auto i = 0; i < 9; ++i)
+			hedging.record(chrono::milliseconds{ 10 });
+		ASSERT_FALSE(hedging.delay());
+
+		hedging.record(chrono::milliseconds{ 10 });
+		ASSERT_TRUE(hedging.delay());
+	}
+
+	TEST(TestHedging, DelayIsThePercentileOfRecentLatencies)
+	{
+		auto hedging = HedgeController{ { true, 0.9, 0.05, 10 } };
+
+		for (auto i = 1; i <= 100; ++i)
+			hedging.record(chrono::milliseconds{ i });
+
+		ASSERT_EQ(chrono::nanoseconds{ chrono::milliseconds{ 91 } }, *hedging.delay());
+
+		hedging.setPolicy({ false });
+		ASSERT_FALSE(hedging.delay());
+	}
+
+	TEST(TestHedging, HedgesAreCappedToARatioOfTheTraffic)
+	{
+		auto hedging = HedgeController{ { true, 0.9, 0.05, 10 } };
+
+		while (hedging.tryHedge())
+		{
+		}
+
+		auto hedges = 0;
+		for (auto i = 0; i < 1000; ++i)
+		{
+			hedging.record(chrono::milliseconds{ 10 });
+			if (hedging.tryHedge())
+				++hedges;
+		}
+
+		ASSERT_GE(hedges, 49);
+		ASSERT_LE(hedges, 50);
+	}
+}
@@ -44,7 +44,7 @@ int main()
 
     auto apiKey = iniParser.getValue("Api Key", "Key");
 
-    auto apiGoogleBooks = GoogleBooksInterfaceWithKeySingleton::getInstance(apiKey);
+    auto& apiGoogleBooks = GoogleBooksInterfaceWithKeySingleton::getInstance(apiKey);
 
     int opt{ 0 };
 